@@ -0,0 +1,494 @@
+/**
+ * VESPA performance benchmark
+ *
+ * Runs the VESPA filters on a ladder of mesh sizes:
+ *  - the .vtk / .vtp / .stl meshes of a data folder,
+ *    and their linear subdivisions,
+ *  - spheres and vessel trees of increasing resolution.
+ * Each mesh is built only when its turn comes and released after.
+ * For each filter and mesh, the filter is executed once to warm up, then
+ * several times. The latency percentiles, the throughput (input triangles
+ * per second at the median latency), the memory and the time spent in
+ * each stage of the filter are written as JSON.
+ * The memory is the resident memory before the runs, and the largest growth
+ * of the resident memory during a run, sampled every millisecond. The warm up
+ * run is included since the memory freed by a run may be reused by the next
+ * ones without growing the resident memory.
+ *
+ * Usage:
+ *   VespaBenchmark [--data <folder>] [--levels <n>] [--repeat <n>]
+ *                  [--max-triangles <n>] [--filters <name,name,...>]
+ *                  [--output <file.json>]
+ */
+
+// VTK related includes
+#include "vtkCellArray.h"
+#include "vtkCleanPolyData.h"
+#include "vtkDataArray.h"
+#include "vtkFieldData.h"
+#include "vtkIntArray.h"
+#include "vtkLinearSubdivisionFilter.h"
+#include "vtkNew.h"
+#include "vtkPolyData.h"
+#include "vtkPolyDataReader.h"
+#include "vtkSTLReader.h"
+#include "vtkSmartPointer.h"
+#include "vtkSphereSource.h"
+#include "vtkStringArray.h"
+#include "vtkTransform.h"
+#include "vtkTransformPolyDataFilter.h"
+#include "vtkTriangleFilter.h"
+#include "vtkVersion.h"
+#include "vtkXMLPolyDataReader.h"
+
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+// VESPA related includes
+#include "vtkCGALBooleanOperation.h"
+#include "vtkCGALIsotropicRemesher.h"
+#include "vtkCGALMeshChecker.h"
+#include "vtkCGALMeshSubdivision.h"
+#include "vtkCGALPatchFilling.h"
+#include "vtkCGALShapeSmoothing.h"
+#include "vtkCGALVesselTreeSource.h"
+#ifdef VESPA_ALPHA_WRAPPING
+#include "vtkCGALAlphaWrapping.h"
+#endif
+
+// CGAL related includes
+#include <CGAL/version.h>
+
+// STL related includes
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+//------------------------------------------------------------------------------
+struct Options
+{
+  std::string              DataDir;
+  std::string              Output;
+  int                      Levels       = 2;
+  int                      Repeat       = 5;
+  vtkIdType                MaxTriangles = 4000000;
+  std::vector<std::string> Filters;
+};
+
+struct Mesh
+{
+  std::string                  Name;
+  vtkSmartPointer<vtkPolyData> Data;
+};
+
+struct Filter
+{
+  std::string                                                         Name;
+  std::function<vtkSmartPointer<vtkCGALPolyDataAlgorithm>(vtkPolyData*)> Make;
+};
+
+//------------------------------------------------------------------------------
+// Largest resident memory of the process from construction to Stop(),
+// sampled on a background thread, in kB
+class MemorySampler
+{
+public:
+  MemorySampler()
+    : Peak(vtkCGALPolyDataAlgorithm::GetCurrentMemory())
+    , Thread([this]() {
+      while (!this->Done)
+      {
+        this->Sample();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    })
+  {
+  }
+
+  long long Stop()
+  {
+    this->Done = true;
+    this->Thread.join();
+    this->Sample();
+    return this->Peak;
+  }
+
+private:
+  void Sample() { this->Peak = std::max(this->Peak, vtkCGALPolyDataAlgorithm::GetCurrentMemory()); }
+
+  std::atomic<bool> Done{ false };
+  long long         Peak;
+  std::thread       Thread;
+};
+
+//------------------------------------------------------------------------------
+// Nearest rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p)
+{
+  if (sorted.empty())
+  {
+    return 0.;
+  }
+  const auto rank = static_cast<std::size_t>(std::ceil(p * sorted.size()));
+  return sorted[std::min(sorted.size(), std::max<std::size_t>(rank, 1)) - 1];
+}
+
+//------------------------------------------------------------------------------
+bool parseArguments(int argc, char* argv[], Options& options)
+{
+  for (int i = 1; i < argc; i++)
+  {
+    const std::string arg  = argv[i];
+    const bool        last = i + 1 >= argc;
+    if (arg == "--data" && !last)
+    {
+      options.DataDir = argv[++i];
+    }
+    else if (arg == "--output" && !last)
+    {
+      options.Output = argv[++i];
+    }
+    else if (arg == "--levels" && !last)
+    {
+      options.Levels = std::stoi(argv[++i]);
+    }
+    else if (arg == "--repeat" && !last)
+    {
+      options.Repeat = std::max(1, std::stoi(argv[++i]));
+    }
+    else if (arg == "--max-triangles" && !last)
+    {
+      options.MaxTriangles = std::stoll(argv[++i]);
+    }
+    else if (arg == "--filters" && !last)
+    {
+      std::stringstream names(argv[++i]);
+      std::string       name;
+      while (std::getline(names, name, ','))
+      {
+        options.Filters.emplace_back(name);
+      }
+    }
+    else
+    {
+      std::cerr << "Usage: " << argv[0]
+                << " [--data <folder>] [--levels <n>] [--repeat <n>]"
+                   " [--max-triangles <n>] [--filters <name,...>] [--output <file.json>]"
+                << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Triangulated, merged surface of a mesh file, nullptr if the format is unknown
+vtkSmartPointer<vtkPolyData> readMesh(const std::string& path)
+{
+  const std::string ext = vtksys::SystemTools::LowerCase(
+    vtksys::SystemTools::GetFilenameLastExtension(path));
+
+  vtkSmartPointer<vtkPolyDataAlgorithm> reader;
+  if (ext == ".vtk")
+  {
+    auto legacy = vtkSmartPointer<vtkPolyDataReader>::New();
+    legacy->SetFileName(path.c_str());
+    reader = legacy;
+  }
+  else if (ext == ".vtp")
+  {
+    auto xml = vtkSmartPointer<vtkXMLPolyDataReader>::New();
+    xml->SetFileName(path.c_str());
+    reader = xml;
+  }
+  else if (ext == ".stl")
+  {
+    auto stl = vtkSmartPointer<vtkSTLReader>::New();
+    stl->SetFileName(path.c_str());
+    reader = stl;
+  }
+  else
+  {
+    return nullptr;
+  }
+
+  vtkNew<vtkTriangleFilter> triangulate;
+  triangulate->SetInputConnection(reader->GetOutputPort());
+  triangulate->PassVertsOff();
+  triangulate->PassLinesOff();
+  vtkNew<vtkCleanPolyData> clean;
+  clean->SetInputConnection(triangulate->GetOutputPort());
+  clean->Update();
+
+  auto mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->ShallowCopy(clean->GetOutput());
+  return mesh->GetNumberOfPolys() > 0 ? mesh : nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Visit the mesh ladder: real meshes, their refinements, spheres and vessel
+// trees. Each mesh is built right before its visit and released after it.
+void forEachMesh(const Options& options, const std::function<void(const Mesh&)>& visit)
+{
+  if (!options.DataDir.empty())
+  {
+    vtksys::Directory dir;
+    if (!dir.Load(options.DataDir))
+    {
+      std::cerr << "Cannot read the data folder " << options.DataDir << std::endl;
+    }
+
+    std::vector<std::string> files;
+    for (unsigned long i = 0; i < dir.GetNumberOfFiles(); i++)
+    {
+      files.emplace_back(dir.GetFile(i));
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const std::string& file : files)
+    {
+      auto mesh = ::readMesh(options.DataDir + "/" + file);
+      if (!mesh)
+      {
+        continue;
+      }
+      visit({ file, mesh });
+
+      // each subdivision level multiplies the number of triangles by 4
+      for (int level = 1; level <= options.Levels &&
+           (mesh->GetNumberOfPolys() << (2 * level)) <= options.MaxTriangles;
+           level++)
+      {
+        vtkNew<vtkLinearSubdivisionFilter> subdivide;
+        subdivide->SetInputData(mesh);
+        subdivide->SetNumberOfSubdivisions(level);
+        subdivide->Update();
+
+        auto refined = vtkSmartPointer<vtkPolyData>::New();
+        refined->ShallowCopy(subdivide->GetOutput());
+        visit({ file + "/subdivided_" + std::to_string(level), refined });
+      }
+    }
+  }
+
+  // a sphere of resolution r has about 2 r^2 triangles
+  for (vtkIdType nbTriangles = 10000; nbTriangles <= options.MaxTriangles; nbTriangles *= 10)
+  {
+    const int resolution = static_cast<int>(std::sqrt(nbTriangles / 2.));
+
+    vtkNew<vtkSphereSource> sphere;
+    sphere->SetThetaResolution(resolution);
+    sphere->SetPhiResolution(resolution);
+    sphere->Update();
+    visit({ "sphere_" + std::to_string(nbTriangles), sphere->GetOutput() });
+  }
+
+  // vessel trees, doubling the triangle density
+  for (double resolution = 2.;; resolution *= std::sqrt(2.))
+  {
+    vtkNew<vtkCGALVesselTreeSource> tree;
+    tree->SetBifurcationDepth(4);
+    tree->SetResolution(resolution);
+    tree->Update();
+    if (tree->GetOutput()->GetNumberOfPolys() > options.MaxTriangles)
+    {
+      break;
+    }
+    visit({ "vessel_tree_" + std::to_string(tree->GetOutput()->GetNumberOfPolys()),
+      tree->GetOutput() });
+  }
+}
+
+//------------------------------------------------------------------------------
+std::vector<Filter> buildFilters()
+{
+  std::vector<Filter> filters;
+
+  filters.push_back({ "IsotropicRemesher", [](vtkPolyData*) {
+                       auto filter = vtkSmartPointer<vtkCGALIsotropicRemesher>::New();
+                       filter->SetNumberOfIterations(1);
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(filter);
+                     } });
+
+  filters.push_back({ "MeshChecker", [](vtkPolyData*) {
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(
+                         vtkSmartPointer<vtkCGALMeshChecker>::New());
+                     } });
+
+  filters.push_back({ "ShapeSmoothing", [](vtkPolyData*) {
+                       auto filter = vtkSmartPointer<vtkCGALShapeSmoothing>::New();
+                       filter->SetNumberOfIterations(1);
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(filter);
+                     } });
+
+  filters.push_back({ "MeshSubdivision", [](vtkPolyData*) {
+                       auto filter = vtkSmartPointer<vtkCGALMeshSubdivision>::New();
+                       filter->SetSubdivisionType(vtkCGALMeshSubdivision::LOOP);
+                       filter->SetNumberOfIterations(1);
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(filter);
+                     } });
+
+  filters.push_back({ "PatchFilling", [](vtkPolyData*) {
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(
+                         vtkSmartPointer<vtkCGALPatchFilling>::New());
+                     } });
+
+  // union with a copy of the mesh moved by a quarter of its size
+  filters.push_back({ "BooleanUnion", [](vtkPolyData* mesh) {
+                       vtkNew<vtkTransform> move;
+                       const double         shift = mesh->GetLength() / 4.;
+                       move->Translate(shift, shift / 2., 0.);
+                       vtkNew<vtkTransformPolyDataFilter> copy;
+                       copy->SetInputData(mesh);
+                       copy->SetTransform(move);
+                       copy->Update();
+
+                       auto filter = vtkSmartPointer<vtkCGALBooleanOperation>::New();
+                       filter->SetOperationType(vtkCGALBooleanOperation::UNION);
+                       filter->SetInputData(1, copy->GetOutput());
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(filter);
+                     } });
+
+#ifdef VESPA_ALPHA_WRAPPING
+  filters.push_back({ "AlphaWrapping", [](vtkPolyData*) {
+                       return vtkSmartPointer<vtkCGALPolyDataAlgorithm>(
+                         vtkSmartPointer<vtkCGALAlphaWrapping>::New());
+                     } });
+#endif
+
+  return filters;
+}
+
+//------------------------------------------------------------------------------
+// Run one filter on one mesh and write the JSON result
+void runBenchmark(const Options& options, const Filter& filterDesc, const Mesh& mesh,
+  std::ostream& json)
+{
+  vtkSmartPointer<vtkCGALPolyDataAlgorithm> filter = filterDesc.Make(mesh.Data);
+  filter->SetInputData(0, mesh.Data);
+  filter->ReportTimingsOn();
+
+  std::vector<double> latencies;
+  const long long     baseMemory   = vtkCGALPolyDataAlgorithm::GetCurrentMemory();
+  long long           maxRunMemory = 0;
+  bool                success      = true;
+  for (int run = 0; run <= options.Repeat; run++)
+  {
+    // the output of the previous run would be released during the run
+    filter->GetOutput()->Initialize();
+    filter->Modified();
+
+    const long long runMemory = vtkCGALPolyDataAlgorithm::GetCurrentMemory();
+    ::MemorySampler sampler;
+    const auto      start = std::chrono::steady_clock::now();
+    success &= filter->GetExecutive()->Update() != 0;
+    const auto end = std::chrono::steady_clock::now();
+    maxRunMemory   = std::max(maxRunMemory, sampler.Stop() - runMemory);
+
+    if (run == 0)
+    {
+      continue; // warm up
+    }
+    latencies.emplace_back(std::chrono::duration<double>(end - start).count());
+  }
+  std::sort(latencies.begin(), latencies.end());
+
+  const vtkIdType nbTriangles = mesh.Data->GetNumberOfPolys();
+  const double    median      = ::percentile(latencies, 0.5);
+
+  json << "    {\"filter\": " << vtkCGALPolyDataAlgorithm::JsonString(filterDesc.Name)
+       << ", \"mesh\": " << vtkCGALPolyDataAlgorithm::JsonString(mesh.Name) << ", \"points\": "
+       << mesh.Data->GetNumberOfPoints() << ", \"triangles\": " << nbTriangles
+       << ", \"success\": " << (success ? "true" : "false") << ", \"runs\": " << latencies.size()
+       << ",\n     \"latency\": {\"min\": " << latencies.front()
+       << ", \"p50\": " << median << ", \"p90\": " << ::percentile(latencies, 0.9)
+       << ", \"p99\": " << ::percentile(latencies, 0.99) << ", \"max\": " << latencies.back()
+       << "}, \"trianglesPerSecond\": " << (median > 0. ? nbTriangles / median : 0.)
+       << ", \"memoryKB\": " << baseMemory << ", \"peakMemoryDeltaKB\": " << maxRunMemory;
+
+  // stages of the last run, first level only
+  vtkFieldData* fd = filter->GetOutput()->GetFieldData();
+  auto names  = vtkStringArray::SafeDownCast(fd->GetAbstractArray("vtkCGALStageNames"));
+  auto depths = vtkIntArray::SafeDownCast(fd->GetArray("vtkCGALStageDepths"));
+  auto times  = fd->GetArray("vtkCGALStageTimes");
+  json << ",\n     \"stages\": [";
+  if (names && depths && times)
+  {
+    bool first = true;
+    for (vtkIdType i = 0; i < names->GetNumberOfValues(); i++)
+    {
+      if (depths->GetValue(i) == 1)
+      {
+        json << (first ? "" : ", ")
+             << "{\"name\": " << vtkCGALPolyDataAlgorithm::JsonString(names->GetValue(i))
+             << ", \"time\": " << times->GetTuple1(i) << "}";
+        first = false;
+      }
+    }
+  }
+  json << "]}";
+}
+}
+
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[])
+{
+  Options options;
+  if (!::parseArguments(argc, argv, options))
+  {
+    return 1;
+  }
+
+  std::vector<Filter> filters = ::buildFilters();
+  if (!options.Filters.empty())
+  {
+    filters.erase(std::remove_if(filters.begin(), filters.end(),
+                    [&](const Filter& filter) {
+                      return std::find(options.Filters.begin(), options.Filters.end(),
+                               filter.Name) == options.Filters.end();
+                    }),
+      filters.end());
+  }
+
+  std::ofstream outFile;
+  if (!options.Output.empty())
+  {
+    outFile.open(options.Output);
+    if (!outFile)
+    {
+      std::cerr << "Cannot write " << options.Output << std::endl;
+      return 1;
+    }
+  }
+  std::ostream& json = options.Output.empty() ? std::cout : outFile;
+
+  json << "{\n  \"vtk\": " << vtkCGALPolyDataAlgorithm::JsonString(vtkVersion::GetVTKVersion())
+       << ",\n  \"cgal\": " << vtkCGALPolyDataAlgorithm::JsonString(CGAL_VERSION_STR)
+       << ",\n  \"hardwareThreads\": " << std::thread::hardware_concurrency()
+       << ",\n  \"repeat\": " << options.Repeat << ",\n  \"results\": [\n";
+
+  bool first = true;
+  ::forEachMesh(options, [&](const Mesh& mesh) {
+    for (const Filter& filter : filters)
+    {
+      std::cerr << filter.Name << " on " << mesh.Name << " ("
+                << mesh.Data->GetNumberOfPolys() << " triangles)" << std::endl;
+      json << (first ? "" : ",\n");
+      ::runBenchmark(options, filter, mesh, json);
+      first = false;
+    }
+  });
+  json << "\n  ]\n}" << std::endl;
+
+  return 0;
+}
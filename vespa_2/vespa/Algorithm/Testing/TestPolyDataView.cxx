@@ -0,0 +1,135 @@
+#include <iostream>
+#include <vector>
+
+#include <vtkCellArray.h>
+#include <vtkNew.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSmartPointer.h>
+
+#include "vtkCGALPolyDataView.h"
+
+#include <CGAL/boost/graph/helpers.h>
+
+namespace
+{
+// Unit square in z = 0, its center and a point above
+const double Points[6][3] = { { 0., 0., 0. }, { 1., 0., 0. }, { 1., 1., 0. }, { 0., 1., 0. },
+  { 0.5, 0.5, 0. }, { 0.5, 0.5, 1. } };
+
+vtkSmartPointer<vtkPolyData> makeMesh(const std::vector<std::vector<vtkIdType>>& cells)
+{
+  vtkNew<vtkPoints> points;
+  for (const double* p : Points)
+  {
+    points->InsertNextPoint(p);
+  }
+  vtkNew<vtkCellArray> polys;
+  for (const auto& cell : cells)
+  {
+    polys->InsertNextCell(static_cast<vtkIdType>(cell.size()), cell.data());
+  }
+  auto mesh = vtkSmartPointer<vtkPolyData>::New();
+  mesh->SetPoints(points);
+  mesh->SetPolys(polys);
+  return mesh;
+}
+
+bool checkStatus(
+  const char* name, const std::vector<std::vector<vtkIdType>>& cells, Vespa_view::Status expected)
+{
+  Vespa_view view;
+  const Vespa_view::Status status = view.build(::makeMesh(cells));
+  if (status != expected)
+  {
+    std::cerr << name << ": status " << status << " instead of " << expected << std::endl;
+    return false;
+  }
+  return true;
+}
+}
+
+int TestPolyDataView(int, char*[])
+{
+  // Halfedge pairing on a fan of 4 triangles around the center
+  // ----------------------------------------------------------
+
+  auto fan = ::makeMesh({ { 0, 1, 4 }, { 1, 2, 4 }, { 2, 3, 4 }, { 3, 0, 4 } });
+
+  Vespa_view view;
+  if (view.build(fan) != Vespa_view::VALID)
+  {
+    std::cerr << "The fan cannot be viewed: status " << view.status() << std::endl;
+    return 1;
+  }
+
+  // 12 face halfedges, then the 4 border halfedges of the square
+  if (view.number_of_faces() != 4 || view.number_of_halfedges() != 16 ||
+    view.number_of_border_halfedges() != 4)
+  {
+    std::cerr << "Wrong number of faces or halfedges" << std::endl;
+    return 1;
+  }
+
+  for (vtkIdType h = 0; h < view.number_of_halfedges(); h++)
+  {
+    const vtkIdType o = view.opposite(h);
+    if (o == h || view.opposite(o) != h || view.source(h) != view.target(o) ||
+      view.target(h) != view.source(o) || view.prev(view.next(h)) != h ||
+      view.is_border(h) != (h >= 12) || (view.is_border(h) && view.is_border(o)))
+    {
+      std::cerr << "Wrong pairing of halfedge " << h << std::endl;
+      return 1;
+    }
+  }
+
+  // the border halfedges form a single loop around the square
+  vtkIdType border = 12;
+  for (int i = 0; i < 4; i++)
+  {
+    const vtkIdType pid = view.source(border);
+    if (pid == 4 || view.target(border) == 4 || view.halfedge_of_vertex(pid) < 12)
+    {
+      std::cerr << "Wrong border halfedge " << border << std::endl;
+      return 1;
+    }
+    border = view.next(border);
+  }
+  if (border != 12)
+  {
+    std::cerr << "The border loop is not closed" << std::endl;
+    return 1;
+  }
+
+  if (CGAL::is_closed(view) || !CGAL::is_triangle_mesh(view) ||
+    degree(Vespa_view_vertex(4), view) != 4)
+  {
+    std::cerr << "Wrong CGAL queries on the fan" << std::endl;
+    return 1;
+  }
+
+  // The pyramid on the square closes the fan
+  auto pyramid = ::makeMesh({ { 0, 1, 4 }, { 1, 2, 4 }, { 2, 3, 4 }, { 3, 0, 4 }, { 1, 0, 5 },
+    { 2, 1, 5 }, { 3, 2, 5 }, { 0, 3, 5 } });
+  if (view.build(pyramid) != Vespa_view::VALID || view.number_of_border_halfedges() != 0 ||
+    !CGAL::is_closed(view))
+  {
+    std::cerr << "The closed pyramid is not viewed as closed" << std::endl;
+    return 1;
+  }
+
+  // Statuses of the meshes that cannot be viewed
+  // --------------------------------------------
+
+  bool ok = true;
+  ok &= ::checkStatus("quad", { { 0, 1, 2, 3 } }, Vespa_view::NOT_TRIANGLES);
+  ok &= ::checkStatus("repeated point", { { 0, 1, 1 } }, Vespa_view::DEGENERATE);
+  // the second triangle goes along 1 -> 4 like the first one
+  ok &= ::checkStatus("flipped face", { { 0, 1, 4 }, { 4, 2, 1 } }, Vespa_view::INCONSISTENT);
+  ok &= ::checkStatus("non-manifold edge", { { 0, 1, 4 }, { 1, 2, 4 }, { 4, 1, 5 } },
+    Vespa_view::NON_MANIFOLD_EDGE);
+  // two triangles only sharing the center
+  ok &= ::checkStatus("bowtie", { { 0, 1, 4 }, { 2, 3, 4 } }, Vespa_view::NON_MANIFOLD_VERTEX);
+
+  return ok ? 0 : 1;
+}
@@ -1,58 +1,631 @@
 #include "vtkCGALPolyDataAlgorithm.h"
 
+// VESPA related includes
+#include "vtkCGALPolyDataView.h"
+
 // VTK related includes
+#include "vtkArrayListTemplate.h"
+#include "vtkCellArray.h"
 #include "vtkCellData.h"
 #include "vtkCellIterator.h"
+#include "vtkDemandDrivenPipeline.h"
+#include "vtkDoubleArray.h"
+#include "vtkFieldData.h"
+#include "vtkIdList.h"
+#include "vtkIdTypeArray.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkIntArray.h"
+#include "vtkLogger.h"
+#include "vtkMath.h"
+#include "vtkNew.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
+#include "vtkPoints.h"
 #include "vtkProbeFilter.h"
 #include "vtkPolyDataNormals.h"
+#include "vtkSMPThreadLocalObject.h"
+#include "vtkSMPTools.h"
+#include "vtkStringArray.h"
+#include "vtkTypeInt32Array.h"
+#include "vtkTypeInt64Array.h"
+
+// STL related includes
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <utility>
+
+// System related includes
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#else
+#include <unistd.h>
+#endif
+#endif
 
 vtkStandardNewMacro(vtkCGALPolyDataAlgorithm);
 
+namespace
+{
+//------------------------------------------------------------------------------
+// Fill the offsets and connectivity arrays of a vtkCellArray directly.
+// offsets has nbCells + 1 entries, writeCell(cellId, out) writes the point ids
+// of the cell at out.
+template <typename ArrayT, typename Functor>
+void fillCells(vtkCellArray* cells, const std::vector<vtkIdType>& offsets, Functor writeCell)
+{
+  using ValueT = typename ArrayT::ValueType;
+
+  const vtkIdType nbCells = static_cast<vtkIdType>(offsets.size()) - 1;
+
+  vtkNew<ArrayT> offArr;
+  offArr->SetNumberOfValues(nbCells + 1);
+  vtkNew<ArrayT> connArr;
+  connArr->SetNumberOfValues(offsets.back());
+
+  ValueT* off  = offArr->GetPointer(0);
+  ValueT* conn = connArr->GetPointer(0);
+
+  vtkSMPTools::For(0, nbCells, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType c = begin; c < end; c++)
+    {
+      off[c] = static_cast<ValueT>(offsets[c]);
+      writeCell(c, conn + offsets[c]);
+    }
+  });
+  off[nbCells] = static_cast<ValueT>(offsets[nbCells]);
+
+  cells->SetData(offArr, connArr);
+}
+
+//------------------------------------------------------------------------------
+// Copy the offsets and connectivity arrays of a vtkCellArray to a soup.
+template <typename ArrayT>
+void copyCells(ArrayT* offArr, ArrayT* connArr, Vespa_soup* soup)
+{
+  const vtkIdType nbOffsets = offArr->GetNumberOfValues();
+  const vtkIdType nbIds     = connArr->GetNumberOfValues();
+  const auto*     off       = offArr->GetPointer(0);
+  const auto*     conn      = connArr->GetPointer(0);
+
+  soup->offsets.resize(nbOffsets);
+  soup->indices.resize(nbIds);
+
+  vtkSMPTools::For(0, nbOffsets, [&](vtkIdType begin, vtkIdType end) {
+    std::copy(off + begin, off + end, soup->offsets.begin() + begin);
+  });
+  vtkSMPTools::For(0, nbIds, [&](vtkIdType begin, vtkIdType end) {
+    std::copy(conn + begin, conn + end, soup->indices.begin() + begin);
+  });
+}
+
+//------------------------------------------------------------------------------
+// Use 32 bits storage for the cells when the index range allows it.
+bool fitsIn32Bits(vtkIdType nbPoints, vtkIdType connectivitySize)
+{
+  const vtkIdType maxId = std::numeric_limits<vtkTypeInt32>::max();
+  return nbPoints <= maxId && connectivitySize <= maxId;
+}
+
+//------------------------------------------------------------------------------
+// Wall clock, in seconds
+double now()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch())
+    .count();
+}
+
+//------------------------------------------------------------------------------
+// Compact VTK ids of the surface elements: vertices and faces of a surface
+// mesh are not contiguous when elements have been removed.
+struct CompactSurface
+{
+  explicit CompactSurface(const CGAL_Surface& surface)
+    : contiguous(!surface.has_garbage())
+  {
+    if (!this->contiguous)
+    {
+      this->vertexList.assign(vertices(surface).begin(), vertices(surface).end());
+      this->faceList.assign(faces(surface).begin(), faces(surface).end());
+      this->vmap.assign(surface.number_of_vertices() + surface.number_of_removed_vertices(), -1);
+      this->fmap.assign(surface.number_of_faces() + surface.number_of_removed_faces(), -1);
+      for (std::size_t i = 0; i < this->vertexList.size(); i++)
+      {
+        this->vmap[this->vertexList[i]] = static_cast<vtkIdType>(i);
+      }
+      for (std::size_t i = 0; i < this->faceList.size(); i++)
+      {
+        this->fmap[this->faceList[i]] = static_cast<vtkIdType>(i);
+      }
+    }
+  }
+
+  Graph_Verts vertex(vtkIdType pid) const
+  {
+    return this->contiguous ? Graph_Verts(pid) : this->vertexList[pid];
+  }
+  Graph_Faces face(vtkIdType cid) const
+  {
+    return this->contiguous ? Graph_Faces(cid) : this->faceList[cid];
+  }
+  vtkIdType pointId(Graph_Verts vertex) const
+  {
+    return this->contiguous ? vtkIdType(vertex) : this->vmap[vertex];
+  }
+  vtkIdType cellId(Graph_Faces face) const
+  {
+    return this->contiguous ? vtkIdType(face) : this->fmap[face];
+  }
+
+  bool                     contiguous;
+  std::vector<Graph_Verts> vertexList;
+  std::vector<Graph_Faces> faceList;
+  std::vector<vtkIdType>   vmap;
+  std::vector<vtkIdType>   fmap;
+};
+
+//------------------------------------------------------------------------------
+// Input points and weights defining the attributes of an output point.
+// Only the heaviest contributions are kept.
+struct Stencil
+{
+  enum
+  {
+    MaxSize = 4
+  };
+
+  int       size = 0;
+  vtkIdType ids[MaxSize];
+  double    weights[MaxSize];
+
+  void add(vtkIdType id, double weight)
+  {
+    for (int i = 0; i < this->size; i++)
+    {
+      if (this->ids[i] == id)
+      {
+        this->weights[i] += weight;
+        return;
+      }
+    }
+    if (this->size < MaxSize)
+    {
+      this->ids[this->size]     = id;
+      this->weights[this->size] = weight;
+      this->size++;
+      return;
+    }
+    int lightest = 0;
+    for (int i = 1; i < MaxSize; i++)
+    {
+      lightest = this->weights[i] < this->weights[lightest] ? i : lightest;
+    }
+    if (this->weights[lightest] < weight)
+    {
+      this->ids[lightest]     = id;
+      this->weights[lightest] = weight;
+    }
+  }
+
+  void normalize()
+  {
+    double sum = 0.;
+    for (int i = 0; i < this->size; i++)
+    {
+      sum += this->weights[i];
+    }
+    for (int i = 0; sum > 0. && i < this->size; i++)
+    {
+      this->weights[i] /= sum;
+    }
+  }
+};
+
+//------------------------------------------------------------------------------
+// Barycentric coordinates of p projected in the input triangle tri,
+// clamped to stay inside the triangle.
+void addBarycentric(vtkPolyData* input, vtkIdList* tri, const double p[3], Stencil& stencil)
+{
+  double a[3], b[3], c[3];
+  input->GetPoint(tri->GetId(0), a);
+  input->GetPoint(tri->GetId(1), b);
+  input->GetPoint(tri->GetId(2), c);
+
+  double v0[3], v1[3], v2[3];
+  vtkMath::Subtract(b, a, v0);
+  vtkMath::Subtract(c, a, v1);
+  vtkMath::Subtract(p, a, v2);
+
+  const double d00   = vtkMath::Dot(v0, v0);
+  const double d01   = vtkMath::Dot(v0, v1);
+  const double d11   = vtkMath::Dot(v1, v1);
+  const double d20   = vtkMath::Dot(v2, v0);
+  const double d21   = vtkMath::Dot(v2, v1);
+  const double denom = d00 * d11 - d01 * d01;
+
+  double w[3] = { 1. / 3., 1. / 3., 1. / 3. };
+  if (denom > 0.)
+  {
+    w[1] = std::max(0., (d11 * d20 - d01 * d21) / denom);
+    w[2] = std::max(0., (d00 * d21 - d01 * d20) / denom);
+    w[0] = std::max(0., 1. - w[1] - w[2]);
+  }
+
+  for (int i = 0; i < 3; i++)
+  {
+    stencil.add(tri->GetId(i), w[i]);
+  }
+  stencil.normalize();
+}
+
+//------------------------------------------------------------------------------
+// Cheap orientation check for polygonal meshes: two neighbor faces are
+// consistent when they traverse their shared edge in opposite directions,
+// so no directed edge may appear twice.
+bool isConsistentlyOriented(vtkPolyData* mesh)
+{
+  if (mesh->GetNumberOfStrips() > 0)
+  {
+    return false; // let vtkPolyDataNormals triangulate them
+  }
+
+  vtkCellArray* polys = mesh->GetPolys();
+  std::vector<std::pair<vtkIdType, vtkIdType>> dEdges;
+  dEdges.reserve(polys->GetNumberOfConnectivityIds());
+
+  vtkIdType        nbIds;
+  const vtkIdType* ids;
+  for (polys->InitTraversal(); polys->GetNextCell(nbIds, ids);)
+  {
+    for (vtkIdType i = 0; i < nbIds; i++)
+    {
+      dEdges.emplace_back(ids[i], ids[(i + 1) % nbIds]);
+    }
+  }
+
+  vtkSMPTools::Sort(dEdges.begin(), dEdges.end());
+  return std::adjacent_find(dEdges.begin(), dEdges.end()) == dEdges.end();
+}
+
+//------------------------------------------------------------------------------
+// Build the halfedge structure of an empty surface mesh in bulk from a valid view.
+// Vertices and faces keep the VTK ids, edge e holds the halfedges 2e and 2e + 1.
+void buildSurface(const Vespa_view& view, Vespa_surface* cgalMesh)
+{
+  using Vertex_index   = CGAL_Surface::Vertex_index;
+  using Halfedge_index = CGAL_Surface::Halfedge_index;
+  using Face_index     = CGAL_Surface::Face_index;
+
+  CGAL_Surface& surface = cgalMesh->surface;
+
+  const vtkIdType nbPoints    = view.number_of_points();
+  const vtkIdType nbFaces     = view.number_of_faces();
+  const vtkIdType nbHalfedges = view.number_of_halfedges();
+
+  // view halfedge -> surface halfedge, the smallest of a pair gets the even slot
+  std::vector<vtkIdType> toSurface(nbHalfedges);
+  vtkIdType              edge = 0;
+  for (vtkIdType h = 0; h < nbHalfedges; h++)
+  {
+    const vtkIdType opp = view.opposite(h);
+    if (h < opp)
+    {
+      toSurface[h]   = 2 * edge;
+      toSurface[opp] = 2 * edge + 1;
+      edge++;
+    }
+  }
+
+  surface.resize(nbPoints, nbHalfedges / 2, nbFaces);
+
+  vtkSMPTools::For(0, nbHalfedges, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType h = begin; h < end; h++)
+    {
+      const Halfedge_index sh(toSurface[h]);
+      surface.set_target(sh, Vertex_index(view.target(h)));
+      surface.set_next(sh, Halfedge_index(toSurface[view.next(h)]));
+      surface.set_face(sh, view.is_border(h) ? Face_index() : Face_index(h / 3));
+    }
+  });
+
+  vtkSMPTools::For(0, nbFaces, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType f = begin; f < end; f++)
+    {
+      surface.set_halfedge(Face_index(f), Halfedge_index(toSurface[3 * f]));
+    }
+  });
+
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType v = begin; v < end; v++)
+    {
+      const vtkIdType h = view.halfedge_of_vertex(v);
+      if (h != -1)
+      {
+        surface.set_halfedge(Vertex_index(v), Halfedge_index(toSurface[h]));
+      }
+      put(cgalMesh->coords, Vertex_index(v), view.point(v));
+      put(cgalMesh->vertex_origin, Vertex_index(v), v);
+    }
+  });
+
+  vtkSMPTools::For(0, nbFaces, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType f = begin; f < end; f++)
+    {
+      put(cgalMesh->face_origin, Face_index(f), f);
+    }
+  });
+}
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALPolyDataAlgorithm::PrintSelf(ostream& os, vtkIndent indent)
 {
   os << indent << "UpdateAttributes:" << this->UpdateAttributes << std::endl;
+  os << indent << "ReportTimings:" << this->ReportTimings << std::endl;
+  os << indent << "TimingsFile:" << this->TimingsFile << std::endl;
+  os << indent << "SolverBackend:" << this->SolverBackend << std::endl;
+  os << indent << "NumberOfThreads:" << this->NumberOfThreads << std::endl;
   this->Superclass::PrintSelf(os, indent);
 }
 
+//------------------------------------------------------------------------------
+long long vtkCGALPolyDataAlgorithm::GetCurrentMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return static_cast<long long>(counters.WorkingSetSize / 1024);
+  }
+  return 0;
+#elif defined(__APPLE__)
+  mach_task_basic_info_data_t info;
+  mach_msg_type_number_t      count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, reinterpret_cast<task_info_t>(&info),
+        &count) != KERN_SUCCESS)
+  {
+    return 0;
+  }
+  return static_cast<long long>(info.resident_size / 1024);
+#else
+  // resident pages, second field of statm
+  std::ifstream statm("/proc/self/statm");
+  long long     size = 0, resident = 0;
+  if (!(statm >> size >> resident))
+  {
+    return 0;
+  }
+  return resident * static_cast<long long>(sysconf(_SC_PAGESIZE)) / 1024;
+#endif
+}
+
+//------------------------------------------------------------------------------
+long long vtkCGALPolyDataAlgorithm::GetPeakMemory()
+{
+#if defined(_WIN32)
+  PROCESS_MEMORY_COUNTERS counters;
+  if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+  {
+    return static_cast<long long>(counters.PeakWorkingSetSize / 1024);
+  }
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+  {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return static_cast<long long>(usage.ru_maxrss / 1024); // bytes
+#else
+  return static_cast<long long>(usage.ru_maxrss); // kB
+#endif
+#endif
+}
+
+//------------------------------------------------------------------------------
+std::string vtkCGALPolyDataAlgorithm::JsonString(const std::string& str)
+{
+  std::string escaped = "\"";
+  for (char c : str)
+  {
+    if (c == '"' || c == '\\')
+    {
+      escaped += '\\';
+      escaped += c;
+    }
+    else if (static_cast<unsigned char>(c) < 0x20)
+    {
+      // control characters are not allowed in JSON strings
+      char code[7];
+      std::snprintf(code, sizeof(code), "\\u%04x", static_cast<unsigned int>(c));
+      escaped += code;
+    }
+    else
+    {
+      escaped += c;
+    }
+  }
+  return escaped + "\"";
+}
+
+//------------------------------------------------------------------------------
+vtkTypeBool vtkCGALPolyDataAlgorithm::ProcessRequest(
+  vtkInformation* request, vtkInformationVector** inInfo, vtkInformationVector* outInfo)
+{
+  if (!request->Has(vtkDemandDrivenPipeline::REQUEST_DATA()))
+  {
+    return this->Superclass::ProcessRequest(request, inInfo, outInfo);
+  }
+
+  this->Stages.clear();
+  this->StageDepth = 0;
+
+  vtkTypeBool res = 0;
+  {
+    StageTimer stage(this, this->GetClassName());
+    res = this->Superclass::ProcessRequest(request, inInfo, outInfo);
+  }
+
+  // Field data
+  if (this->ReportTimings)
+  {
+    vtkNew<vtkStringArray> names;
+    names->SetName("vtkCGALStageNames");
+    vtkNew<vtkIntArray> depths;
+    depths->SetName("vtkCGALStageDepths");
+    vtkNew<vtkDoubleArray> times;
+    times->SetName("vtkCGALStageTimes");
+    vtkNew<vtkIdTypeArray> memory;
+    memory->SetName("vtkCGALStagePeakMemoryDelta");
+    vtkNew<vtkIdTypeArray> elements;
+    elements->SetName("vtkCGALStageElements");
+    for (const Stage& stage : this->Stages)
+    {
+      names->InsertNextValue(stage.Name);
+      depths->InsertNextValue(stage.Depth);
+      times->InsertNextValue(stage.Time);
+      memory->InsertNextValue(stage.PeakMemoryDelta);
+      elements->InsertNextValue(stage.NumberOfElements);
+    }
+
+    for (int port = 0; port < outInfo->GetNumberOfInformationObjects(); port++)
+    {
+      vtkDataObject* output = vtkDataObject::GetData(outInfo, port);
+      if (output)
+      {
+        // the field data may be shared with the input by a shallow copy
+        vtkNew<vtkFieldData> fd;
+        fd->ShallowCopy(output->GetFieldData());
+        output->SetFieldData(fd);
+        fd->AddArray(names);
+        fd->AddArray(depths);
+        fd->AddArray(times);
+        fd->AddArray(memory);
+        fd->AddArray(elements);
+      }
+    }
+  }
+
+  // JSON, one execution per line
+  if (!this->TimingsFile.empty())
+  {
+    std::ofstream json(this->TimingsFile, std::ios::app);
+    if (!json)
+    {
+      vtkWarningMacro("Cannot open timings file " << this->TimingsFile);
+      return res;
+    }
+    json << "{\"filter\": " << this->JsonString(this->GetClassName()) << ", \"stages\": [";
+    for (std::size_t i = 0; i < this->Stages.size(); i++)
+    {
+      const Stage& stage = this->Stages[i];
+      json << (i ? ", " : "") << "{\"name\": " << this->JsonString(stage.Name)
+           << ", \"depth\": " << stage.Depth << ", \"time\": " << stage.Time
+           << ", \"peakMemoryDelta\": " << stage.PeakMemoryDelta
+           << ", \"elements\": " << stage.NumberOfElements << "}";
+    }
+    json << "]}" << std::endl;
+  }
+
+  return res;
+}
+
+//------------------------------------------------------------------------------
+vtkCGALPolyDataAlgorithm::StageTimer::StageTimer(
+  vtkCGALPolyDataAlgorithm* self, const std::string& name, vtkIdType nbElements)
+  : Self(self)
+  , Index(self->Stages.size())
+  , Start(::now())
+  , StartMemory(vtkCGALPolyDataAlgorithm::GetPeakMemory())
+{
+  self->Stages.push_back({ name, self->StageDepth, 0., 0, nbElements });
+  self->StageDepth++;
+  vtkLogStartScope(TRACE, name.c_str());
+}
+
+//------------------------------------------------------------------------------
+vtkCGALPolyDataAlgorithm::StageTimer::~StageTimer()
+{
+  Stage& stage          = this->Self->Stages[this->Index];
+  stage.Time            = ::now() - this->Start;
+  stage.PeakMemoryDelta = vtkCGALPolyDataAlgorithm::GetPeakMemory() - this->StartMemory;
+  this->Self->StageDepth--;
+
+  vtkLog(TRACE,
+    stage.Name << ": " << stage.Time << " s, +" << stage.PeakMemoryDelta << " kB peak, "
+               << stage.NumberOfElements << " elements");
+  vtkLogEndScope(stage.Name.c_str());
+}
+
+//------------------------------------------------------------------------------
+void vtkCGALPolyDataAlgorithm::StageTimer::SetNumberOfElements(vtkIdType nbElements)
+{
+  this->Self->Stages[this->Index].NumberOfElements = nbElements;
+}
+
 //------------------------------------------------------------------------------
 bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_soup* cgalMesh)
 {
+  StageTimer stage(this, "toCGAL soup", vtkMesh->GetNumberOfCells());
 
   // Points
   const vtkIdType inNPts = vtkMesh->GetNumberOfPoints();
-  cgalMesh->points.clear();
-  cgalMesh->points.reserve(inNPts);
+  cgalMesh->points.resize(inNPts);
 
-  for (vtkIdType pid = 0; pid < inNPts; pid++)
+  vtkSMPTools::For(0, inNPts, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      double coords[3];
+      vtkMesh->GetPoint(pid, coords);
+      cgalMesh->points[pid] = CGAL_Kernel::Point_3(coords[0], coords[1], coords[2]);
+    }
+  });
+
+  // Cells
+  vtkCellArray* polys = vtkMesh->GetPolys();
+  if (vtkMesh->GetNumberOfVerts() == 0 && vtkMesh->GetNumberOfLines() == 0 &&
+    vtkMesh->GetNumberOfStrips() == 0 && polys)
   {
-    double coords[3];
-    vtkMesh->GetPoint(pid, coords);
-    cgalMesh->points.emplace_back(coords[0], coords[1], coords[2]);
+    // polygons only: the VTK arrays already are compressed rows
+    if (polys->IsStorage64Bit())
+    {
+      ::copyCells(polys->GetOffsetsArray64(), polys->GetConnectivityArray64(), cgalMesh);
+    }
+    else
+    {
+      ::copyCells(polys->GetOffsetsArray32(), polys->GetConnectivityArray32(), cgalMesh);
+    }
+    return true;
   }
 
-  // Cells
-  const vtkIdType inNCells = vtkMesh->GetNumberOfCells();
-  cgalMesh->faces.clear();
-  cgalMesh->faces.resize(inNCells);
+  cgalMesh->offsets.assign(1, 0);
+  cgalMesh->offsets.reserve(vtkMesh->GetNumberOfCells() + 1);
+  cgalMesh->indices.clear();
 
-  vtkIdType cid = 0;
-  auto      cit = vtk::TakeSmartPointer(vtkMesh->NewCellIterator());
-  for (cit->InitTraversal(); !cit->IsDoneWithTraversal(); cit->GoToNextCell(), cid++)
+  auto cit = vtk::TakeSmartPointer(vtkMesh->NewCellIterator());
+  for (cit->InitTraversal(); !cit->IsDoneWithTraversal(); cit->GoToNextCell())
   {
     // Add the cell
     vtkIdList* ids   = cit->GetPointIds();
     vtkIdType  nbIds = cit->GetNumberOfPoints();
 
-    cgalMesh->faces[cid].reserve(3); // mostly triangles
-
-    std::vector<Graph_Verts> cell(nbIds);
     for (vtkIdType i = 0; i < nbIds; i++)
     {
-      cgalMesh->faces[cid].emplace_back(ids->GetId(i));
+      cgalMesh->indices.emplace_back(ids->GetId(i));
     }
+    cgalMesh->offsets.emplace_back(cgalMesh->indices.size());
   }
 
   return true;
@@ -61,25 +634,56 @@ bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_soup* cgalMesh
 //------------------------------------------------------------------------------
 bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_surface* cgalMesh)
 {
+  StageTimer stage(this, "toCGAL surface", vtkMesh->GetNumberOfCells());
+
   bool status = true;
 
-  // preprocess: ensure cell consistency in VTK
-  // this is required by CGAL
+  // preprocess: ensure cell consistency in VTK, this is required by CGAL.
+  // The orientation is only fixed when the input is not found consistent
+  // already by the view or by a check on the directed edges.
+  Vespa_view         view;
+  Vespa_view::Status viewStatus = view.build(vtkMesh);
+
+  bool consistent = viewStatus == Vespa_view::VALID;
+  if (viewStatus == Vespa_view::NOT_TRIANGLES)
+  {
+    consistent = ::isConsistentlyOriented(vtkMesh);
+  }
+
+  // cell ids are only kept when the reorientation did not change the cells
+  const vtkIdType            inNCells = vtkMesh->GetNumberOfCells();
   vtkNew<vtkPolyDataNormals> consistency;
-  consistency->SetInputData(vtkMesh);
-  consistency->SplittingOff();
-  consistency->NonManifoldTraversalOff();
-  consistency->Update();
-  vtkMesh = consistency->GetOutput(0);
+  if (!consistent)
+  {
+    consistency->SetInputData(vtkMesh);
+    consistency->SplittingOff();
+    consistency->NonManifoldTraversalOff();
+    consistency->Update();
+    vtkMesh    = consistency->GetOutput(0);
+    viewStatus = view.build(vtkMesh);
+  }
 
+  // Fast path: manifold triangles are assembled in bulk
+  if (viewStatus == Vespa_view::VALID && cgalMesh->surface.is_empty())
+  {
+    ::buildSurface(view, cgalMesh);
+    return true;
+  }
+
+  // Generic path: polygons, or non-manifold input to be reported
   // Vertices
   const vtkIdType inNPts = vtkMesh->GetNumberOfPoints();
 
+  cgalMesh->surface.reserve(cgalMesh->surface.number_of_vertices() + inNPts,
+    cgalMesh->surface.number_of_edges() + 3 * vtkMesh->GetNumberOfCells() / 2,
+    cgalMesh->surface.number_of_faces() + vtkMesh->GetNumberOfCells());
+
   std::vector<Graph_Verts> surfaceVertices(inNPts);
   for (vtkIdType i = 0; i < inNPts; i++)
   {
     // id
     surfaceVertices[i] = add_vertex(cgalMesh->surface);
+    put(cgalMesh->vertex_origin, surfaceVertices[i], i);
 
     // coords
     double coords[3];
@@ -89,14 +693,16 @@ bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_surface* cgalM
   }
 
   // Cells
-  auto cit = vtk::TakeSmartPointer(vtkMesh->NewCellIterator());
+  const bool               keepCellIds = vtkMesh->GetNumberOfCells() == inNCells;
+  std::vector<Graph_Verts> cell;
+  auto                     cit = vtk::TakeSmartPointer(vtkMesh->NewCellIterator());
   for (cit->InitTraversal(); !cit->IsDoneWithTraversal(); cit->GoToNextCell())
   {
     // Add the cell
     vtkIdList* ids   = cit->GetPointIds();
     vtkIdType  nbIds = cit->GetNumberOfPoints();
 
-    std::vector<Graph_Verts> cell(nbIds);
+    cell.resize(nbIds);
     for (vtkIdType i = 0; i < nbIds; i++)
     {
       cell[i] = surfaceVertices[ids->GetId(i)];
@@ -105,6 +711,10 @@ bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_surface* cgalM
     // Fails on non-manifold cells
     auto newFace = CGAL::Euler::add_face(cell, cgalMesh->surface);
     status &= newFace.is_valid();
+    if (newFace.is_valid() && keepCellIds)
+    {
+      put(cgalMesh->face_origin, newFace, cit->GetCellId());
+    }
   }
 
   if (!status)
@@ -117,36 +727,58 @@ bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_surface* cgalM
   return status;
 }
 
+//------------------------------------------------------------------------------
+bool vtkCGALPolyDataAlgorithm::toCGAL(vtkPolyData* vtkMesh, Vespa_view* cgalMesh)
+{
+  StageTimer stage(this, "toCGAL view", vtkMesh->GetNumberOfCells());
+
+  return cgalMesh->build(vtkMesh) == Vespa_view::VALID;
+}
+
 //------------------------------------------------------------------------------
 bool vtkCGALPolyDataAlgorithm::toVTK(Vespa_soup const* cgalMesh, vtkPolyData* vtkMesh)
 {
-  // points (vertices in surfaceMesh are not contiguous)
-  vtkNew<vtkPoints> pts;
-  const vtkIdType   outNPts = cgalMesh->points.size();
-  pts->Allocate(outNPts);
+  StageTimer stage(this, "toVTK soup", cgalMesh->number_of_faces());
 
-  for (auto point : cgalMesh->points)
-  {
-    pts->InsertNextPoint(point[0], point[1], point[2]);
-  }
-  pts->Squeeze();
+  // points
+  const vtkIdType        outNPts = cgalMesh->points.size();
+  vtkNew<vtkDoubleArray> coords;
+  coords->SetNumberOfComponents(3);
+  coords->SetNumberOfTuples(outNPts);
+  double* coordsPtr = coords->GetPointer(0);
 
-  // cells
-  vtkNew<vtkCellArray> cells;
-  cells->AllocateEstimate(cgalMesh->faces.size(), 3);
+  vtkSMPTools::For(0, outNPts, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      const auto& p          = cgalMesh->points[pid];
+      coordsPtr[3 * pid]     = CGAL::to_double(p.x());
+      coordsPtr[3 * pid + 1] = CGAL::to_double(p.y());
+      coordsPtr[3 * pid + 2] = CGAL::to_double(p.z());
+    }
+  });
 
-  for (auto face : cgalMesh->faces)
-  {
-    vtkNew<vtkIdList> ids;
-    ids->Allocate(face.size());
+  vtkNew<vtkPoints> pts;
+  pts->SetData(coords);
+
+  // cells, the soup is already stored as offsets and connectivity
+  std::vector<vtkIdType> offsets(cgalMesh->offsets.begin(), cgalMesh->offsets.end());
 
-    for (auto id : face)
+  auto writeCell = [&](vtkIdType cid, auto* out) {
+    for (auto id : cgalMesh->face(cid))
     {
-      ids->InsertNextId(id);
+      *out++ = id;
     }
-    cells->InsertNextCell(ids);
+  };
+
+  vtkNew<vtkCellArray> cells;
+  if (::fitsIn32Bits(outNPts, offsets.back()))
+  {
+    ::fillCells<vtkTypeInt32Array>(cells, offsets, writeCell);
+  }
+  else
+  {
+    ::fillCells<vtkTypeInt64Array>(cells, offsets, writeCell);
   }
-  cells->Squeeze();
 
   // VTK dataset
   vtkMesh->Reset(); // always start from new mesh
@@ -159,36 +791,64 @@ bool vtkCGALPolyDataAlgorithm::toVTK(Vespa_soup const* cgalMesh, vtkPolyData* vt
 //------------------------------------------------------------------------------
 bool vtkCGALPolyDataAlgorithm::toVTK(Vespa_surface const* cgalMesh, vtkPolyData* vtkMesh)
 {
-  // points (vertices in surfaceMesh are not contiguous)
+  StageTimer stage(this, "toVTK surface", num_faces(cgalMesh->surface));
+
+  const CGAL_Surface& surface = cgalMesh->surface;
+
+  // vertices and faces in surfaceMesh are not contiguous when
+  // elements have been removed: list them to get compact ids.
+  const ::CompactSurface ids(surface);
+
+  // points
+  const vtkIdType        outNPts = num_vertices(surface);
+  vtkNew<vtkDoubleArray> coords;
+  coords->SetNumberOfComponents(3);
+  coords->SetNumberOfTuples(outNPts);
+  double* coordsPtr = coords->GetPointer(0);
+
+  vtkSMPTools::For(0, outNPts, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      const auto& p          = get(cgalMesh->coords, ids.vertex(pid));
+      coordsPtr[3 * pid]       = CGAL::to_double(p.x());
+      coordsPtr[3 * pid + 1]   = CGAL::to_double(p.y());
+      coordsPtr[3 * pid + 2]   = CGAL::to_double(p.z());
+    }
+  });
+
   vtkNew<vtkPoints> pts;
-  const vtkIdType   outNPts = num_vertices(cgalMesh->surface);
-  pts->Allocate(outNPts);
-  std::vector<vtkIdType> vmap(outNPts);
+  pts->SetData(coords);
 
-  for (auto vertex : vertices(cgalMesh->surface))
+  // cells, offsets are computed first to size the connectivity exactly
+  const vtkIdType        outNCells = num_faces(surface);
+  std::vector<vtkIdType> offsets(outNCells + 1, 0);
+  vtkSMPTools::For(0, outNCells, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType cid = begin; cid < end; cid++)
+    {
+      offsets[cid + 1] = surface.degree(ids.face(cid));
+    }
+  });
+  for (vtkIdType cid = 0; cid < outNCells; cid++)
   {
-    const auto& p = get(cgalMesh->coords, vertex);
-    vtkIdType   id =
-      pts->InsertNextPoint(CGAL::to_double(p.x()), CGAL::to_double(p.y()), CGAL::to_double(p.z()));
-    vmap[vertex] = id;
+    offsets[cid + 1] += offsets[cid];
   }
-  pts->Squeeze();
-
-  // cells
-  vtkNew<vtkCellArray> cells;
-  cells->AllocateEstimate(num_faces(cgalMesh->surface), 3);
 
-  for (auto face : faces(cgalMesh->surface))
-  {
-    vtkNew<vtkIdList> ids;
-    ids->Allocate(3);
-    for (auto edge : halfedges_around_face(halfedge(face, cgalMesh->surface), cgalMesh->surface))
+  auto writeCell = [&](vtkIdType cid, auto* out) {
+    for (auto edge : halfedges_around_face(halfedge(ids.face(cid), surface), surface))
     {
-      ids->InsertNextId(vmap[source(edge, cgalMesh->surface)]);
+      *out++ = ids.pointId(source(edge, surface));
     }
-    cells->InsertNextCell(ids);
+  };
+
+  vtkNew<vtkCellArray> cells;
+  if (::fitsIn32Bits(outNPts, offsets.back()))
+  {
+    ::fillCells<vtkTypeInt32Array>(cells, offsets, writeCell);
+  }
+  else
+  {
+    ::fillCells<vtkTypeInt64Array>(cells, offsets, writeCell);
   }
-  cells->Squeeze();
 
   // VTK dataset
   vtkMesh->Reset(); // always start from new mesh
@@ -203,6 +863,8 @@ bool vtkCGALPolyDataAlgorithm::interpolateAttributes(vtkPolyData* input, vtkPoly
 {
   if (this->UpdateAttributes)
   {
+    StageTimer stage(this, "interpolateAttributes probe", vtkMesh->GetNumberOfPoints());
+
     vtkNew<vtkProbeFilter> probe;
     probe->SetInputData(vtkMesh);
     probe->SetSourceData(input);
@@ -214,11 +876,273 @@ bool vtkCGALPolyDataAlgorithm::interpolateAttributes(vtkPolyData* input, vtkPoly
   return true;
 }
 
+//------------------------------------------------------------------------------
+bool vtkCGALPolyDataAlgorithm::interpolateAttributes(
+  vtkPolyData* input, Vespa_surface const* cgalMesh, vtkPolyData* vtkMesh)
+{
+  if (!this->UpdateAttributes)
+  {
+    return true;
+  }
+
+  const CGAL_Surface& surface   = cgalMesh->surface;
+  const vtkIdType     inNPts    = input->GetNumberOfPoints();
+  const vtkIdType     inNCells  = input->GetNumberOfCells();
+  const vtkIdType     outNPts   = vtkMesh->GetNumberOfPoints();
+  const vtkIdType     outNCells = vtkMesh->GetNumberOfCells();
+  if (outNPts != static_cast<vtkIdType>(num_vertices(surface)) ||
+    outNCells != static_cast<vtkIdType>(num_faces(surface)))
+  {
+    // vtkMesh is not the direct export of cgalMesh
+    return this->interpolateAttributes(input, vtkMesh);
+  }
+
+  StageTimer stage(this, "interpolateAttributes origins", outNPts);
+
+  const ::CompactSurface ids(surface);
+
+  // Points coming from an input point or lying on an input triangle
+  // ---------------------------------------------------------------
+
+  if (input->NeedToBuildCells())
+  {
+    input->BuildCells();
+  }
+
+  std::vector<::Stencil>             stencils(outNPts);
+  vtkSMPThreadLocalObject<vtkIdList> tlTriangle;
+  vtkSMPTools::For(0, outNPts, [&](vtkIdType begin, vtkIdType end) {
+    vtkIdList* triangle = tlTriangle.Local();
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      const Graph_Verts vertex = ids.vertex(pid);
+      const vtkIdType   origin = get(cgalMesh->vertex_origin, vertex);
+      if (origin >= 0 && origin < inNPts)
+      {
+        stencils[pid].add(origin, 1.);
+        continue;
+      }
+
+      if (halfedge(vertex, surface) == boost::graph_traits<CGAL_Surface>::null_halfedge())
+      {
+        continue; // isolated vertex
+      }
+      for (auto edge : halfedges_around_target(halfedge(vertex, surface), surface))
+      {
+        const Graph_Faces face = CGAL::face(edge, surface);
+        if (face == boost::graph_traits<CGAL_Surface>::null_face())
+        {
+          continue;
+        }
+        const vtkIdType faceOrigin = get(cgalMesh->face_origin, face);
+        if (faceOrigin < 0 || faceOrigin >= inNCells)
+        {
+          continue;
+        }
+        input->GetCellPoints(faceOrigin, triangle);
+        if (triangle->GetNumberOfIds() == 3)
+        {
+          double p[3];
+          vtkMesh->GetPoint(pid, p);
+          ::addBarycentric(input, triangle, p, stencils[pid]);
+          break;
+        }
+      }
+    }
+  });
+
+  std::vector<vtkIdType> pendingPts;
+  for (vtkIdType pid = 0; pid < outNPts; pid++)
+  {
+    if (stencils[pid].size == 0)
+    {
+      pendingPts.emplace_back(pid);
+    }
+  }
+  if (outNPts > 0 && static_cast<vtkIdType>(pendingPts.size()) == outNPts)
+  {
+    // no provenance recorded by the CGAL processing
+    return this->interpolateAttributes(input, vtkMesh);
+  }
+
+  // Other points average their resolved neighbors, ring after ring
+  // ---------------------------------------------------------------
+
+  std::vector<int> pointLevel(outNPts, 0);
+  for (vtkIdType pid : pendingPts)
+  {
+    pointLevel[pid] = std::numeric_limits<int>::max();
+  }
+
+  for (int level = 1; !pendingPts.empty(); level++)
+  {
+    const vtkIdType nbPending = static_cast<vtkIdType>(pendingPts.size());
+    vtkSMPTools::For(0, nbPending, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        const vtkIdType   pid    = pendingPts[i];
+        const Graph_Verts vertex = ids.vertex(pid);
+        if (halfedge(vertex, surface) == boost::graph_traits<CGAL_Surface>::null_halfedge())
+        {
+          continue;
+        }
+
+        std::vector<vtkIdType> neighbors;
+        for (auto edge : halfedges_around_target(halfedge(vertex, surface), surface))
+        {
+          const vtkIdType nid = ids.pointId(source(edge, surface));
+          if (pointLevel[nid] < level)
+          {
+            neighbors.emplace_back(nid);
+          }
+        }
+        for (vtkIdType nid : neighbors)
+        {
+          const ::Stencil& neighbor = stencils[nid];
+          for (int k = 0; k < neighbor.size; k++)
+          {
+            stencils[pid].add(neighbor.ids[k], neighbor.weights[k] / neighbors.size());
+          }
+        }
+        stencils[pid].normalize();
+      }
+    });
+
+    auto resolved = std::partition(pendingPts.begin(), pendingPts.end(),
+      [&](vtkIdType pid) { return stencils[pid].size == 0; });
+    if (resolved == pendingPts.end())
+    {
+      break; // remaining points are not connected to any resolved one
+    }
+    for (auto it = resolved; it != pendingPts.end(); ++it)
+    {
+      pointLevel[*it] = level;
+    }
+    pendingPts.erase(resolved, pendingPts.end());
+  }
+
+  // Cells take the data of their origin cell, or of a neighbor
+  // ----------------------------------------------------------
+
+  std::vector<vtkIdType> cellSources(outNCells, -1);
+  vtkSMPTools::For(0, outNCells, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType cid = begin; cid < end; cid++)
+    {
+      const vtkIdType origin = get(cgalMesh->face_origin, ids.face(cid));
+      cellSources[cid]       = origin < inNCells ? origin : -1;
+    }
+  });
+
+  std::vector<vtkIdType> pendingCells;
+  for (vtkIdType cid = 0; cid < outNCells; cid++)
+  {
+    if (cellSources[cid] < 0)
+    {
+      pendingCells.emplace_back(cid);
+    }
+  }
+
+  std::vector<int> cellLevel(outNCells, 0);
+  for (vtkIdType cid : pendingCells)
+  {
+    cellLevel[cid] = std::numeric_limits<int>::max();
+  }
+
+  for (int level = 1; !pendingCells.empty(); level++)
+  {
+    const vtkIdType nbPending = static_cast<vtkIdType>(pendingCells.size());
+    vtkSMPTools::For(0, nbPending, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        const vtkIdType cid = pendingCells[i];
+        for (auto edge : halfedges_around_face(halfedge(ids.face(cid), surface), surface))
+        {
+          const Graph_Faces neighbor = CGAL::face(opposite(edge, surface), surface);
+          if (neighbor == boost::graph_traits<CGAL_Surface>::null_face())
+          {
+            continue;
+          }
+          const vtkIdType nid = ids.cellId(neighbor);
+          if (cellLevel[nid] < level)
+          {
+            cellSources[cid] = cellSources[nid];
+            break;
+          }
+        }
+      }
+    });
+
+    auto resolved = std::partition(pendingCells.begin(), pendingCells.end(),
+      [&](vtkIdType cid) { return cellSources[cid] < 0; });
+    if (resolved == pendingCells.end())
+    {
+      break;
+    }
+    for (auto it = resolved; it != pendingCells.end(); ++it)
+    {
+      cellLevel[*it] = level;
+    }
+    pendingCells.erase(resolved, pendingCells.end());
+  }
+
+  // Single parallel transfer of the attributes
+  // ------------------------------------------
+
+  vtkPointData* outPD = vtkMesh->GetPointData();
+  outPD->Initialize();
+  outPD->InterpolateAllocate(input->GetPointData(), outNPts);
+  ArrayList pointArrays;
+  pointArrays.AddArrays(outNPts, input->GetPointData(), outPD);
+
+  vtkCellData* outCD = vtkMesh->GetCellData();
+  outCD->Initialize();
+  outCD->CopyAllocate(input->GetCellData(), outNCells);
+  ArrayList cellArrays;
+  cellArrays.AddArrays(outNCells, input->GetCellData(), outCD);
+
+  vtkSMPTools::For(0, outNPts, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      const ::Stencil& stencil = stencils[pid];
+      if (stencil.size == 0)
+      {
+        pointArrays.AssignNullValue(pid);
+      }
+      else if (stencil.size == 1)
+      {
+        pointArrays.Copy(stencil.ids[0], pid);
+      }
+      else
+      {
+        pointArrays.Interpolate(stencil.size, stencil.ids, stencil.weights, pid);
+      }
+    }
+  });
+
+  vtkSMPTools::For(0, outNCells, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType cid = begin; cid < end; cid++)
+    {
+      if (cellSources[cid] < 0)
+      {
+        cellArrays.AssignNullValue(cid);
+      }
+      else
+      {
+        cellArrays.Copy(cellSources[cid], cid);
+      }
+    }
+  });
+
+  return true;
+}
+
 //------------------------------------------------------------------------------
 bool vtkCGALPolyDataAlgorithm::copyAttributes(vtkPolyData* input, vtkPolyData* vtkMesh)
 {
   if (this->UpdateAttributes)
   {
+    StageTimer stage(this, "copyAttributes", vtkMesh->GetNumberOfPoints());
+
     vtkMesh->GetPointData()->ShallowCopy(input->GetPointData());
     vtkMesh->GetCellData()->ShallowCopy(input->GetCellData());
   }
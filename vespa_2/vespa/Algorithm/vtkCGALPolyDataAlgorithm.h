@@ -21,6 +21,16 @@
 #include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
 #include <CGAL/Surface_mesh.h>
 
+// Boost includes
+#include <boost/iterator/iterator_facade.hpp>
+#include <boost/range/iterator_range.hpp>
+
+// STL includes
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
 using CGAL_Kernel  = CGAL::Exact_predicates_inexact_constructions_kernel;
 using CGAL_Surface = CGAL::Surface_mesh<CGAL_Kernel::Point_3>;
 using Graph_Verts  = boost::graph_traits<CGAL_Surface>::vertex_descriptor;
@@ -30,27 +40,159 @@ using Graph_Coord  = boost::property_map<CGAL_Surface, CGAL::vertex_point_t>::ty
 #include "vtkCGALAlgorithmModule.h" // For export macro
 
 /**
- * Container for CGAL surfaces
- * Stores a set of points and triangles
+ * Container for CGAL polygon soups
+ * Stores a set of points and polygons in compressed rows:
+ * face f uses the point ids indices[offsets[f]] to indices[offsets[f + 1] - 1].
+ * faces() can be given directly to the read-only CGAL soup functions
+ * (polygon_soup_to_polygon_mesh, alpha_wrap_3, ...), functions editing
+ * the soup work on to_triangles() / to_polygons() and assign() back.
  */
 struct Vespa_soup
 {
-  std::vector<CGAL_Kernel::Point_3>     points;
-  std::vector<std::vector<std::size_t>> faces;
+  using Face = boost::iterator_range<const std::size_t*>;
+
+  /**
+   * Random access range of the faces, each one being a
+   * random access range of point ids
+   */
+  class Face_range
+  {
+  public:
+    class const_iterator
+      : public boost::iterator_facade<const_iterator, Face, std::random_access_iterator_tag, Face>
+    {
+    public:
+      const_iterator() = default;
+      const_iterator(const Vespa_soup* soup, std::size_t f)
+        : soup_(soup)
+        , f_(f)
+      {
+      }
+
+    private:
+      friend class boost::iterator_core_access;
+
+      Face           dereference() const { return this->soup_->face(this->f_); }
+      bool           equal(const const_iterator& other) const { return this->f_ == other.f_; }
+      void           increment() { ++this->f_; }
+      void           decrement() { --this->f_; }
+      void           advance(std::ptrdiff_t n) { this->f_ += n; }
+      std::ptrdiff_t distance_to(const const_iterator& other) const
+      {
+        return static_cast<std::ptrdiff_t>(other.f_) - static_cast<std::ptrdiff_t>(this->f_);
+      }
+
+      const Vespa_soup* soup_ = nullptr;
+      std::size_t       f_    = 0;
+    };
+
+    using iterator   = const_iterator;
+    using value_type = Face;
+    using size_type  = std::size_t;
+
+    explicit Face_range(const Vespa_soup* soup)
+      : soup_(soup)
+    {
+    }
+
+    size_type      size() const { return this->soup_->number_of_faces(); }
+    bool           empty() const { return this->size() == 0; }
+    Face           operator[](size_type f) const { return this->soup_->face(f); }
+    const_iterator begin() const { return const_iterator(this->soup_, 0); }
+    const_iterator end() const { return const_iterator(this->soup_, this->size()); }
+
+  private:
+    const Vespa_soup* soup_;
+  };
+
+  std::vector<CGAL_Kernel::Point_3> points;
+  std::vector<std::size_t>          offsets = { 0 };
+  std::vector<std::size_t>          indices;
+
+  std::size_t number_of_faces() const { return this->offsets.size() - 1; }
+  Face        face(std::size_t f) const
+  {
+    const std::size_t* ids = this->indices.data();
+    return Face(ids + this->offsets[f], ids + this->offsets[f + 1]);
+  }
+  Face_range faces() const { return Face_range(this); }
+
+  bool is_triangle_soup() const
+  {
+    for (std::size_t f = 0; f < this->number_of_faces(); f++)
+    {
+      if (this->offsets[f + 1] - this->offsets[f] != 3)
+      {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<std::array<std::size_t, 3>> to_triangles() const
+  {
+    std::vector<std::array<std::size_t, 3>> triangles(this->number_of_faces());
+    for (std::size_t f = 0; f < triangles.size(); f++)
+    {
+      std::copy(this->face(f).begin(), this->face(f).end(), triangles[f].begin());
+    }
+    return triangles;
+  }
+
+  std::vector<std::vector<std::size_t>> to_polygons() const
+  {
+    std::vector<std::vector<std::size_t>> polygons(this->number_of_faces());
+    for (std::size_t f = 0; f < polygons.size(); f++)
+    {
+      polygons[f].assign(this->face(f).begin(), this->face(f).end());
+    }
+    return polygons;
+  }
+
+  template <typename PolygonRange>
+  void assign(const PolygonRange& polygons)
+  {
+    this->offsets.assign(1, 0);
+    this->offsets.reserve(polygons.size() + 1);
+    this->indices.clear();
+    for (const auto& polygon : polygons)
+    {
+      this->indices.insert(this->indices.end(), polygon.begin(), polygon.end());
+      this->offsets.push_back(this->indices.size());
+    }
+  }
 };
 
+using Graph_Vorig = CGAL_Surface::Property_map<Graph_Verts, vtkIdType>;
+using Graph_Forig = CGAL_Surface::Property_map<Graph_Faces, vtkIdType>;
+
 /**
  * Container for CGAL surfaces
  * Stores a 2-manifold triangulation
+ * vertex_origin and face_origin hold the VTK point / cell id each
+ * element comes from, -1 for elements created by the CGAL processing.
  */
 struct Vespa_surface
 {
   CGAL_Surface surface;
   Graph_Coord  coords;
+  Graph_Vorig  vertex_origin;
+  Graph_Forig  face_origin;
 
-  Vespa_surface() { coords = get(CGAL::vertex_point, surface); }
+  Vespa_surface()
+  {
+    coords        = get(CGAL::vertex_point, surface);
+    vertex_origin = surface.add_property_map<Graph_Verts, vtkIdType>("v:vespa_origin", -1).first;
+    face_origin   = surface.add_property_map<Graph_Faces, vtkIdType>("f:vespa_origin", -1).first;
+  }
 };
 
+/**
+ * Read-only CGAL FaceGraph over the VTK buffers,
+ * see vtkCGALPolyDataView.h
+ */
+struct Vespa_view;
+
 // Filter
 class VTKCGALALGORITHM_EXPORT vtkCGALPolyDataAlgorithm : public vtkPolyDataAlgorithm
 {
@@ -64,8 +206,14 @@ public:
   /**
    * Choose if the result mesh should have the
    * point / cell data attributes of the input.
-   * If so, a vtkProbeFilter is called in order
-   * to interpolate values to the new mesh.
+   * If so, when the CGAL mesh records the input point and face
+   * each of its vertices and faces comes from, a point takes the
+   * values of its input point, or interpolates the input triangle
+   * it lies on, and the remaining points average their neighbors.
+   * A cell takes the values of its input cell, or of a neighbor.
+   * When the output is not the direct export of the CGAL mesh,
+   * or no origin is recorded, a vtkProbeFilter interpolates the
+   * values at the output points instead.
    * Default is true
    **/
   vtkGetMacro(UpdateAttributes, bool);
@@ -73,10 +221,117 @@ public:
   vtkBooleanMacro(UpdateAttributes, bool);
   //@}
 
+  //@{
+  /**
+   * Choose if the wall time, peak memory growth and number of elements
+   * of each processing stage should be added to the output field data,
+   * in the vtkCGALStage* arrays.
+   * Stages are always reported through vtkLogger scopes.
+   * Default is false
+   **/
+  vtkGetMacro(ReportTimings, bool);
+  vtkSetMacro(ReportTimings, bool);
+  vtkBooleanMacro(ReportTimings, bool);
+  //@}
+
+  //@{
+  /**
+   * When not empty, the stages of each execution are appended
+   * to this file as a JSON object on a single line.
+   * Default is empty
+   **/
+  vtkGetMacro(TimingsFile, std::string);
+  vtkSetMacro(TimingsFile, std::string);
+  //@}
+
+  /**
+   * Sparse linear solvers for the filters solving linear systems
+   * (deformation, fairing and hole filling).
+   * - DIRECT_SOLVER: supernodal LU, on one thread
+   * - PARALLEL_DIRECT_SOLVER: multithreaded Pardiso LU, if VESPA is built with Intel MKL,
+   *   the direct solver otherwise
+   * - ITERATIVE_SOLVER: preconditioned BiCGSTAB, with a low memory use
+   **/
+  enum SolverBackends
+  {
+    DIRECT_SOLVER = 0,
+    PARALLEL_DIRECT_SOLVER,
+    ITERATIVE_SOLVER
+  };
+
+  //@{
+  /**
+   * Get/set the sparse linear solver, for the filters solving linear systems.
+   * Default is DIRECT_SOLVER
+   **/
+  vtkGetMacro(SolverBackend, int);
+  vtkSetClampMacro(SolverBackend, int, DIRECT_SOLVER, ITERATIVE_SOLVER);
+  //@}
+
+  //@{
+  /**
+   * Get/set the maximum number of threads of the parallel CGAL algorithms,
+   * i.e. the self intersection checks if VESPA is built with TBB.
+   * 0 uses all the cores.
+   * Default is 0
+   **/
+  vtkGetMacro(NumberOfThreads, int);
+  vtkSetClampMacro(NumberOfThreads, int, 0, VTK_INT_MAX);
+  //@}
+
+  //@{
+  /**
+   * Resident memory of the process, in kB: the current one, and the
+   * peak one since the process started, which never decreases.
+   * Return 0 when the platform does not provide it.
+   **/
+  static long long GetCurrentMemory();
+  static long long GetPeakMemory();
+  //@}
+
+  /**
+   * Quote str as a JSON string, escaping the quotes,
+   * backslashes and control characters.
+   **/
+  static std::string JsonString(const std::string& str);
+
+  /**
+   * Reset the stages before each execution and report them after.
+   */
+  vtkTypeBool ProcessRequest(
+    vtkInformation* request, vtkInformationVector** inInfo, vtkInformationVector* outInfo) override;
+
 protected:
   vtkCGALPolyDataAlgorithm()           = default;
   ~vtkCGALPolyDataAlgorithm() override = default;
 
+  /**
+   * Record a processing stage, from construction to destruction:
+   * wall time, growth of the peak resident memory and number
+   * of processed elements. Stages created while another one is
+   * alive are nested in it.
+   * The stages are not thread safe: a StageTimer must only be
+   * created in the thread running RequestData, around the
+   * vtkSMPTools calls, never inside their workers.
+   */
+  class VTKCGALALGORITHM_EXPORT StageTimer
+  {
+  public:
+    StageTimer(vtkCGALPolyDataAlgorithm* self, const std::string& name, vtkIdType nbElements = 0);
+    ~StageTimer();
+
+    void SetNumberOfElements(vtkIdType nbElements);
+
+  private:
+    StageTimer(const StageTimer&) = delete;
+    void operator=(const StageTimer&) = delete;
+
+    vtkCGALPolyDataAlgorithm* Self;
+    std::size_t               Index;
+    double                    Start;
+    long long                 StartMemory;
+  };
+
   /**
    * Convert a vtkPolyData to a CGAL surface mesh.
    * This method fills the internal points and cells
@@ -88,11 +343,22 @@ protected:
   /**
    * Convert a vtkPolyData to a CGAL surface mesh.
    * This method fills the internal surface and coords
-   * in the Vespa_surface data object
+   * in the Vespa_surface data object.
+   * Faces are reoriented first unless vtkMesh is
+   * already consistently oriented.
    * return true if operation was successful
    */
   bool toCGAL(vtkPolyData* vtkMesh, Vespa_surface* cgalMesh);
 
+  /**
+   * Wrap a vtkPolyData in a read-only CGAL face graph.
+   * No copy of the points or cells is done, the view
+   * is only valid as long as vtkMesh is not modified.
+   * return true if vtkMesh is a 2-manifold, consistently
+   * oriented triangulation the view can describe.
+   */
+  bool toCGAL(vtkPolyData* vtkMesh, Vespa_view* cgalMesh);
+
   /**
    * Convert a CGAL polygon soup to a vtkPolydata.
    * return true if operation was successful
@@ -112,6 +378,17 @@ protected:
    */
   bool interpolateAttributes(vtkPolyData* input, vtkPolyData* vtkMesh);
 
+  /**
+   * Transfer attributes of input onto vtkMesh, the toVTK output
+   * of cgalMesh, if UpdateAttributes is true.
+   * Elements are matched through the origins recorded in cgalMesh:
+   * points are copied or interpolated in their input triangle,
+   * new elements take the values of their closest neighbors.
+   * Falls back on the spatial interpolation when no origin is known.
+   */
+  bool interpolateAttributes(
+    vtkPolyData* input, Vespa_surface const* cgalMesh, vtkPolyData* vtkMesh);
+
   /**
    * Copy the attributes of input onto vtkMesh
    * if UpdateAttributes is true.
@@ -120,7 +397,23 @@ protected:
 
   // Fields
 
-  bool UpdateAttributes = true;
+  bool        UpdateAttributes = true;
+  bool        ReportTimings    = false;
+  std::string TimingsFile      = "";
+  int         SolverBackend    = DIRECT_SOLVER;
+  int         NumberOfThreads  = 0;
+
+  struct Stage
+  {
+    std::string Name;
+    int         Depth;
+    double      Time;
+    long long   PeakMemoryDelta; // kB
+    vtkIdType   NumberOfElements;
+  };
+  // only modified by StageTimer, in the thread running RequestData
+  std::vector<Stage> Stages;
+  int                StageDepth = 0;
 
 private:
   vtkCGALPolyDataAlgorithm(const vtkCGALPolyDataAlgorithm&) = delete;
@@ -0,0 +1,271 @@
+#include "vtkCGALPolyDataView.h"
+
+// VTK related includes
+#include "vtkCellArray.h"
+#include "vtkDoubleArray.h"
+#include "vtkFloatArray.h"
+#include "vtkNew.h"
+#include "vtkPoints.h"
+#include "vtkSMPTools.h"
+#include "vtkTypeInt32Array.h"
+#include "vtkTypeInt64Array.h"
+
+// STL related includes
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+// Directed edge of a triangle, keyed by its undirected extremities
+struct DirectedEdge
+{
+  vtkIdType lo;
+  vtkIdType hi;
+  vtkIdType h; // halfedge 3 * face + corner
+};
+
+bool operator<(const DirectedEdge& a, const DirectedEdge& b)
+{
+  return a.lo < b.lo || (a.lo == b.lo && (a.hi < b.hi || (a.hi == b.hi && a.h < b.h)));
+}
+}
+
+//------------------------------------------------------------------------------
+CGAL_Kernel::Point_3 Vespa_view::point(vtkIdType pid) const
+{
+  if (this->pointsDouble_)
+  {
+    const double* p = this->pointsDouble_ + 3 * pid;
+    return CGAL_Kernel::Point_3(p[0], p[1], p[2]);
+  }
+  const float* p = this->pointsFloat_ + 3 * pid;
+  return CGAL_Kernel::Point_3(p[0], p[1], p[2]);
+}
+
+//------------------------------------------------------------------------------
+Vespa_view::Status Vespa_view::build(vtkPolyData* mesh)
+{
+  this->status_ = EMPTY;
+  this->opposite_.clear();
+  this->borderNext_.clear();
+  this->borderPrev_.clear();
+  this->vertexHalfedge_.clear();
+  this->mesh_       = mesh;
+  this->pointsData_ = nullptr;
+  this->nbPoints_   = 0;
+  this->nbFaces_    = 0;
+
+  if (!mesh || !mesh->GetPoints() || !mesh->GetPolys())
+  {
+    return this->status_;
+  }
+
+  // Cells: triangles only, so that face f is the cell f
+  // ---------------------------------------------------
+
+  vtkCellArray* polys = mesh->GetPolys();
+  if (mesh->GetNumberOfVerts() > 0 || mesh->GetNumberOfLines() > 0 ||
+    mesh->GetNumberOfStrips() > 0 || polys->GetNumberOfCells() == 0 ||
+    polys->IsHomogeneous() != 3)
+  {
+    this->status_ = NOT_TRIANGLES;
+    return this->status_;
+  }
+
+  this->conn32_ = nullptr;
+  this->conn64_ = nullptr;
+  if (polys->IsStorage64Bit())
+  {
+    this->conn64_ = polys->GetConnectivityArray64()->GetPointer(0);
+  }
+  else
+  {
+    this->conn32_ = polys->GetConnectivityArray32()->GetPointer(0);
+  }
+
+  // Points: read float or double buffers in place
+  // ---------------------------------------------
+
+  this->pointsFloat_  = nullptr;
+  this->pointsDouble_ = nullptr;
+  this->pointsData_   = mesh->GetPoints()->GetData();
+  if (auto dArr = vtkDoubleArray::FastDownCast(this->pointsData_))
+  {
+    this->pointsDouble_ = dArr->GetPointer(0);
+  }
+  else if (auto fArr = vtkFloatArray::FastDownCast(this->pointsData_))
+  {
+    this->pointsFloat_ = fArr->GetPointer(0);
+  }
+  else
+  {
+    // unusual point type, fall back on a double copy
+    vtkNew<vtkDoubleArray> copy;
+    copy->DeepCopy(this->pointsData_);
+    this->pointsData_   = copy;
+    this->pointsDouble_ = copy->GetPointer(0);
+  }
+
+  this->nbPoints_ = mesh->GetNumberOfPoints();
+  this->nbFaces_  = polys->GetNumberOfCells();
+
+  const vtkIdType nbFaceHalfedges = 3 * this->nbFaces_;
+
+  // Pair halfedges by sorting the directed edges
+  // --------------------------------------------
+
+  std::vector<DirectedEdge> dEdges(nbFaceHalfedges);
+  std::atomic<bool>         degenerate(false);
+  vtkSMPTools::For(0, nbFaceHalfedges, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType h = begin; h < end; h++)
+    {
+      const vtkIdType s = this->corner(h);
+      const vtkIdType t = this->corner(this->next(h));
+      if (s == t)
+      {
+        degenerate = true;
+      }
+      dEdges[h] = { std::min(s, t), std::max(s, t), h };
+    }
+  });
+  if (degenerate)
+  {
+    this->status_ = DEGENERATE;
+    return this->status_;
+  }
+
+  vtkSMPTools::Sort(dEdges.begin(), dEdges.end());
+
+  this->opposite_.assign(nbFaceHalfedges, -1);
+  vtkIdType nbBorders    = 0;
+  bool      inconsistent = false;
+  for (vtkIdType i = 0; i < nbFaceHalfedges;)
+  {
+    vtkIdType j = i + 1;
+    while (j < nbFaceHalfedges && dEdges[j].lo == dEdges[i].lo && dEdges[j].hi == dEdges[i].hi)
+    {
+      j++;
+    }
+
+    if (j - i > 2)
+    {
+      this->status_ = NON_MANIFOLD_EDGE;
+      return this->status_;
+    }
+    else if (j - i == 2)
+    {
+      const vtkIdType h0 = dEdges[i].h;
+      const vtkIdType h1 = dEdges[i + 1].h;
+      // opposite halfedges must go in opposite directions
+      inconsistent |= this->corner(h0) == this->corner(h1);
+      this->opposite_[h0] = h1;
+      this->opposite_[h1] = h0;
+    }
+    else
+    {
+      nbBorders++;
+    }
+    i = j;
+  }
+
+  if (inconsistent)
+  {
+    this->status_ = INCONSISTENT;
+    return this->status_;
+  }
+
+  // Border halfedges and loops
+  // --------------------------
+
+  this->opposite_.resize(nbFaceHalfedges + nbBorders);
+  this->borderNext_.assign(nbBorders, -1);
+  this->borderPrev_.assign(nbBorders, -1);
+
+  // outgoing border halfedge of each vertex
+  std::vector<vtkIdType> outBorder(this->nbPoints_, -1);
+  vtkIdType              b = nbFaceHalfedges;
+  for (vtkIdType h = 0; h < nbFaceHalfedges; h++)
+  {
+    if (this->opposite_[h] == -1)
+    {
+      this->opposite_[h] = b;
+      this->opposite_[b] = h;
+
+      const vtkIdType s = this->source(b);
+      if (outBorder[s] != -1)
+      {
+        // several border fans around a vertex
+        this->status_ = NON_MANIFOLD_VERTEX;
+        return this->status_;
+      }
+      outBorder[s] = b;
+      b++;
+    }
+  }
+
+  for (vtkIdType h = nbFaceHalfedges; h < nbFaceHalfedges + nbBorders; h++)
+  {
+    const vtkIdType n = outBorder[this->target(h)];
+    if (n == -1)
+    {
+      this->status_ = NON_MANIFOLD_VERTEX;
+      return this->status_;
+    }
+    this->borderNext_[h - nbFaceHalfedges] = n;
+    this->borderPrev_[n - nbFaceHalfedges] = h;
+  }
+
+  // Vertex halfedges, border ones first as CGAL expects
+  // ---------------------------------------------------
+
+  this->vertexHalfedge_.assign(this->nbPoints_, -1);
+  std::vector<vtkIdType> valence(this->nbPoints_, 0);
+  for (vtkIdType h = 0; h < nbFaceHalfedges; h++)
+  {
+    const vtkIdType t        = this->corner(this->next(h));
+    this->vertexHalfedge_[t] = h;
+    valence[t]++;
+  }
+  for (vtkIdType v = 0; v < this->nbPoints_; v++)
+  {
+    if (outBorder[v] != -1)
+    {
+      this->vertexHalfedge_[v] = this->borderPrev_[outBorder[v] - nbFaceHalfedges];
+    }
+  }
+
+  // Each vertex must have a single umbrella
+  // ---------------------------------------
+
+  std::atomic<bool> nonManifold(false);
+  vtkSMPTools::For(0, this->nbPoints_, [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType v = begin; v < end && !nonManifold; v++)
+    {
+      const vtkIdType start = this->vertexHalfedge_[v];
+      if (start == -1)
+      {
+        continue; // isolated vertex
+      }
+      vtkIdType nbFaces = 0;
+      vtkIdType h       = start;
+      do
+      {
+        nbFaces += this->is_border(h) ? 0 : 1;
+        h = this->opposite_[this->next(h)];
+      } while (h != start);
+
+      if (nbFaces != valence[v])
+      {
+        nonManifold = true;
+      }
+    }
+  });
+  if (nonManifold)
+  {
+    this->status_ = NON_MANIFOLD_VERTEX;
+    return this->status_;
+  }
+
+  this->status_ = VALID;
+  return this->status_;
+}
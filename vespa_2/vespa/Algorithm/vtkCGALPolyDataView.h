@@ -0,0 +1,708 @@
+/**
+ * @file    vtkCGALPolyDataView.h
+ * @brief   read-only CGAL FaceGraph view over a triangulated vtkPolyData
+ *
+ * Vespa_view models the CGAL HalfedgeGraph and FaceListGraph concepts directly
+ * on top of the vtkPoints and vtkCellArray buffers of a vtkPolyData.
+ * Read-only CGAL algorithms (is_closed, does_bound_a_volume, does_self_intersect...)
+ * can then be run on the VTK mesh without building a CGAL::Surface_mesh.
+ *
+ * Points and triangles are never copied: only the halfedge pairing and the
+ * border loops are stored next to the VTK buffers.
+ * The view can only describe 2-manifold, consistently oriented, pure triangle
+ * meshes. Vespa_view::build reports why a mesh could not be viewed so the caller
+ * can fall back on the Vespa_soup / Vespa_surface conversions.
+ *
+ * Vertices are the VTK point ids and faces are the VTK cell ids of the polys.
+ * Halfedge 3 * f + i goes from the i-th to the (i+1)-th point of the face f,
+ * border halfedges are numbered after the 3 * nbFaces face halfedges.
+ */
+
+#ifndef vtkCGALPolyDataView_h
+#define vtkCGALPolyDataView_h
+
+// VTK includes
+#include "vtkDataArray.h"
+#include "vtkPolyData.h"
+#include "vtkSmartPointer.h"
+#include "vtkType.h"
+
+// VESPA includes
+#include "vtkCGALPolyDataAlgorithm.h"
+
+// CGAL includes
+#include <CGAL/Iterator_range.h>
+#include <CGAL/boost/graph/iterator.h>
+#include <CGAL/boost/graph/properties.h>
+
+// Boost includes
+#include <boost/graph/graph_traits.hpp>
+#include <boost/iterator/iterator_facade.hpp>
+
+// STL includes
+#include <functional>
+#include <vector>
+
+#include "vtkCGALAlgorithmModule.h" // For export macro
+
+struct Vespa_view_vertex_tag
+{
+};
+struct Vespa_view_halfedge_tag
+{
+};
+struct Vespa_view_face_tag
+{
+};
+
+/**
+ * Typed index used as vertex, halfedge and face descriptor of the view.
+ * The default constructed index is the null descriptor.
+ */
+template <typename Tag>
+class Vespa_view_index
+{
+public:
+  using size_type = std::size_t;
+
+  Vespa_view_index() = default;
+  explicit Vespa_view_index(vtkIdType idx)
+    : idx_(idx)
+  {
+  }
+
+  vtkIdType idx() const { return this->idx_; }
+  bool      is_valid() const { return this->idx_ >= 0; }
+  operator size_type() const { return static_cast<size_type>(this->idx_); }
+
+  bool operator==(const Vespa_view_index& other) const { return this->idx_ == other.idx_; }
+  bool operator!=(const Vespa_view_index& other) const { return this->idx_ != other.idx_; }
+  bool operator<(const Vespa_view_index& other) const { return this->idx_ < other.idx_; }
+
+  Vespa_view_index& operator++()
+  {
+    ++this->idx_;
+    return *this;
+  }
+  Vespa_view_index& operator--()
+  {
+    --this->idx_;
+    return *this;
+  }
+
+private:
+  vtkIdType idx_ = -1;
+};
+
+using Vespa_view_vertex   = Vespa_view_index<Vespa_view_vertex_tag>;
+using Vespa_view_halfedge = Vespa_view_index<Vespa_view_halfedge_tag>;
+using Vespa_view_face     = Vespa_view_index<Vespa_view_face_tag>;
+
+/**
+ * Edge descriptor of the view, identified by its smallest halfedge.
+ */
+class Vespa_view_edge
+{
+public:
+  Vespa_view_edge() = default;
+  explicit Vespa_view_edge(Vespa_view_halfedge h)
+    : halfedge_(h)
+  {
+  }
+
+  Vespa_view_halfedge halfedge() const { return this->halfedge_; }
+  vtkIdType           idx() const { return this->halfedge_.idx(); }
+
+  bool operator==(const Vespa_view_edge& other) const { return this->halfedge_ == other.halfedge_; }
+  bool operator!=(const Vespa_view_edge& other) const { return this->halfedge_ != other.halfedge_; }
+  bool operator<(const Vespa_view_edge& other) const { return this->halfedge_ < other.halfedge_; }
+
+private:
+  Vespa_view_halfedge halfedge_;
+};
+
+template <typename Tag>
+inline std::size_t hash_value(const Vespa_view_index<Tag>& i)
+{
+  return static_cast<std::size_t>(i.idx());
+}
+
+inline std::size_t hash_value(const Vespa_view_edge& e)
+{
+  return static_cast<std::size_t>(e.idx());
+}
+
+/**
+ * Read-only view of a triangulated vtkPolyData as a CGAL FaceGraph
+ */
+struct VTKCGALALGORITHM_EXPORT Vespa_view
+{
+  enum Status
+  {
+    VALID = 0,
+    EMPTY,               // no mesh was given
+    NOT_TRIANGLES,       // contains other cells than triangles
+    DEGENERATE,          // a triangle uses the same point twice
+    INCONSISTENT,        // neighbor faces have opposite orientations
+    NON_MANIFOLD_EDGE,   // an edge is shared by more than two faces
+    NON_MANIFOLD_VERTEX  // a vertex has several umbrellas
+  };
+
+  /**
+   * Pair the halfedges of the polys of mesh.
+   * The mesh should not be modified while the view is in use.
+   * return the status of the view, VALID when the view can be used.
+   */
+  Status build(vtkPolyData* mesh);
+
+  Status status() const { return this->status_; }
+  bool   is_valid() const { return this->status_ == VALID; }
+
+  vtkIdType number_of_points() const { return this->nbPoints_; }
+  vtkIdType number_of_faces() const { return this->nbFaces_; }
+  vtkIdType number_of_halfedges() const { return static_cast<vtkIdType>(this->opposite_.size()); }
+  vtkIdType number_of_border_halfedges() const
+  {
+    return static_cast<vtkIdType>(this->borderNext_.size());
+  }
+
+  /**
+   * Coordinates of the point pid, read from the VTK buffer.
+   */
+  CGAL_Kernel::Point_3 point(vtkIdType pid) const;
+
+  /**
+   * Point id stored at the given corner (3 * face + i) of the polys.
+   */
+  vtkIdType corner(vtkIdType c) const
+  {
+    return this->conn64_ ? static_cast<vtkIdType>(this->conn64_[c])
+                         : static_cast<vtkIdType>(this->conn32_[c]);
+  }
+
+  // Raw connectivity, used by the BGL free functions below
+  // ------------------------------------------------------
+
+  bool is_border(vtkIdType h) const { return h >= 3 * this->nbFaces_; }
+
+  vtkIdType opposite(vtkIdType h) const { return this->opposite_[h]; }
+
+  vtkIdType next(vtkIdType h) const
+  {
+    return this->is_border(h) ? this->borderNext_[h - 3 * this->nbFaces_]
+                              : h - h % 3 + (h % 3 + 1) % 3;
+  }
+
+  vtkIdType prev(vtkIdType h) const
+  {
+    return this->is_border(h) ? this->borderPrev_[h - 3 * this->nbFaces_]
+                              : h - h % 3 + (h % 3 + 2) % 3;
+  }
+
+  vtkIdType source(vtkIdType h) const
+  {
+    return this->is_border(h) ? this->corner(this->next(this->opposite_[h]))
+                              : this->corner(h);
+  }
+
+  vtkIdType target(vtkIdType h) const
+  {
+    return this->is_border(h) ? this->corner(this->opposite_[h])
+                              : this->corner(this->next(h));
+  }
+
+  vtkIdType halfedge_of_vertex(vtkIdType pid) const { return this->vertexHalfedge_[pid]; }
+
+private:
+  Status    status_   = EMPTY;
+  vtkIdType nbPoints_ = 0;
+  vtkIdType nbFaces_  = 0;
+
+  // keep the VTK buffers alive
+  vtkSmartPointer<vtkPolyData>  mesh_;
+  vtkSmartPointer<vtkDataArray> pointsData_;
+
+  const float*        pointsFloat_  = nullptr;
+  const double*       pointsDouble_ = nullptr;
+  const vtkTypeInt32* conn32_       = nullptr;
+  const vtkTypeInt64* conn64_       = nullptr;
+
+  // halfedge pairing, face halfedges first then border halfedges
+  std::vector<vtkIdType> opposite_;
+  // border loops, indexed by (h - 3 * nbFaces)
+  std::vector<vtkIdType> borderNext_;
+  std::vector<vtkIdType> borderPrev_;
+  // one incoming halfedge per vertex, a border one when available
+  std::vector<vtkIdType> vertexHalfedge_;
+};
+
+// Iterators
+// ---------
+
+/**
+ * Random access iterator on the descriptors of the view
+ */
+template <typename Index>
+class Vespa_view_iterator
+  : public boost::iterator_facade<Vespa_view_iterator<Index>, Index,
+      std::random_access_iterator_tag>
+{
+public:
+  Vespa_view_iterator() = default;
+  explicit Vespa_view_iterator(Index idx)
+    : idx_(idx)
+  {
+  }
+
+private:
+  friend class boost::iterator_core_access;
+
+  const Index& dereference() const { return this->idx_; }
+  bool         equal(const Vespa_view_iterator& other) const { return this->idx_ == other.idx_; }
+  void         increment() { ++this->idx_; }
+  void         decrement() { --this->idx_; }
+  void         advance(std::ptrdiff_t n) { this->idx_ = Index(this->idx_.idx() + n); }
+  std::ptrdiff_t distance_to(const Vespa_view_iterator& other) const
+  {
+    return static_cast<std::ptrdiff_t>(other.idx_.idx() - this->idx_.idx());
+  }
+
+  Index idx_;
+};
+
+/**
+ * Forward iterator on the edges of the view:
+ * visits the face halfedges smaller than their opposite.
+ */
+class Vespa_view_edge_iterator
+  : public boost::iterator_facade<Vespa_view_edge_iterator, Vespa_view_edge,
+      std::forward_iterator_tag>
+{
+public:
+  Vespa_view_edge_iterator() = default;
+  Vespa_view_edge_iterator(const Vespa_view* view, vtkIdType h)
+    : view_(view)
+    , edge_(Vespa_view_halfedge(h))
+  {
+    this->skip();
+  }
+
+private:
+  friend class boost::iterator_core_access;
+
+  const Vespa_view_edge& dereference() const { return this->edge_; }
+  bool equal(const Vespa_view_edge_iterator& other) const { return this->edge_ == other.edge_; }
+  void increment()
+  {
+    this->edge_ = Vespa_view_edge(Vespa_view_halfedge(this->edge_.idx() + 1));
+    this->skip();
+  }
+  void skip()
+  {
+    const vtkIdType end = 3 * this->view_->number_of_faces();
+    vtkIdType       h   = this->edge_.idx();
+    while (h < end && this->view_->opposite(h) < h)
+    {
+      h++;
+    }
+    this->edge_ = Vespa_view_edge(Vespa_view_halfedge(h));
+  }
+
+  const Vespa_view* view_ = nullptr;
+  Vespa_view_edge   edge_;
+};
+
+// Graph traits
+// ------------
+
+struct Vespa_view_traversal_category
+  : public virtual boost::bidirectional_graph_tag
+  , public virtual boost::vertex_list_graph_tag
+  , public virtual boost::edge_list_graph_tag
+{
+};
+
+namespace boost
+{
+template <>
+struct graph_traits<Vespa_view>
+{
+  using vertex_descriptor   = Vespa_view_vertex;
+  using halfedge_descriptor = Vespa_view_halfedge;
+  using edge_descriptor     = Vespa_view_edge;
+  using face_descriptor     = Vespa_view_face;
+
+  using vertex_iterator   = Vespa_view_iterator<vertex_descriptor>;
+  using halfedge_iterator = Vespa_view_iterator<halfedge_descriptor>;
+  using face_iterator     = Vespa_view_iterator<face_descriptor>;
+  using edge_iterator     = Vespa_view_edge_iterator;
+
+  using out_edge_iterator = CGAL::Out_edge_iterator<Vespa_view>;
+  using in_edge_iterator  = CGAL::In_edge_iterator<Vespa_view>;
+
+  using directed_category      = boost::undirected_tag;
+  using edge_parallel_category = boost::allow_parallel_edge_tag;
+  using traversal_category     = Vespa_view_traversal_category;
+
+  using vertices_size_type  = std::size_t;
+  using edges_size_type     = std::size_t;
+  using halfedges_size_type = std::size_t;
+  using faces_size_type     = std::size_t;
+  using degree_size_type    = std::size_t;
+
+  static vertex_descriptor   null_vertex() { return vertex_descriptor(); }
+  static halfedge_descriptor null_halfedge() { return halfedge_descriptor(); }
+  static face_descriptor     null_face() { return face_descriptor(); }
+};
+
+template <>
+struct graph_traits<const Vespa_view> : public graph_traits<Vespa_view>
+{
+};
+} // namespace boost
+
+// BGL free functions
+// ------------------
+
+inline std::size_t num_vertices(const Vespa_view& g)
+{
+  return static_cast<std::size_t>(g.number_of_points());
+}
+
+inline std::size_t num_faces(const Vespa_view& g)
+{
+  return static_cast<std::size_t>(g.number_of_faces());
+}
+
+inline std::size_t num_halfedges(const Vespa_view& g)
+{
+  return static_cast<std::size_t>(g.number_of_halfedges());
+}
+
+inline std::size_t num_edges(const Vespa_view& g)
+{
+  return num_halfedges(g) / 2;
+}
+
+inline CGAL::Iterator_range<Vespa_view_iterator<Vespa_view_vertex>> vertices(const Vespa_view& g)
+{
+  using It = Vespa_view_iterator<Vespa_view_vertex>;
+  return CGAL::make_range(It(Vespa_view_vertex(0)), It(Vespa_view_vertex(g.number_of_points())));
+}
+
+inline CGAL::Iterator_range<Vespa_view_iterator<Vespa_view_halfedge>> halfedges(
+  const Vespa_view& g)
+{
+  using It = Vespa_view_iterator<Vespa_view_halfedge>;
+  return CGAL::make_range(
+    It(Vespa_view_halfedge(0)), It(Vespa_view_halfedge(g.number_of_halfedges())));
+}
+
+inline CGAL::Iterator_range<Vespa_view_iterator<Vespa_view_face>> faces(const Vespa_view& g)
+{
+  using It = Vespa_view_iterator<Vespa_view_face>;
+  return CGAL::make_range(It(Vespa_view_face(0)), It(Vespa_view_face(g.number_of_faces())));
+}
+
+inline CGAL::Iterator_range<Vespa_view_edge_iterator> edges(const Vespa_view& g)
+{
+  return CGAL::make_range(
+    Vespa_view_edge_iterator(&g, 0), Vespa_view_edge_iterator(&g, 3 * g.number_of_faces()));
+}
+
+inline Vespa_view_vertex source(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return Vespa_view_vertex(g.source(h.idx()));
+}
+
+inline Vespa_view_vertex target(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return Vespa_view_vertex(g.target(h.idx()));
+}
+
+inline Vespa_view_halfedge opposite(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return Vespa_view_halfedge(g.opposite(h.idx()));
+}
+
+inline Vespa_view_halfedge next(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return Vespa_view_halfedge(g.next(h.idx()));
+}
+
+inline Vespa_view_halfedge prev(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return Vespa_view_halfedge(g.prev(h.idx()));
+}
+
+inline Vespa_view_face face(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  return g.is_border(h.idx()) ? Vespa_view_face() : Vespa_view_face(h.idx() / 3);
+}
+
+inline Vespa_view_halfedge halfedge(Vespa_view_face f, const Vespa_view&)
+{
+  return Vespa_view_halfedge(3 * f.idx());
+}
+
+inline Vespa_view_halfedge halfedge(Vespa_view_vertex v, const Vespa_view& g)
+{
+  return Vespa_view_halfedge(g.halfedge_of_vertex(v.idx()));
+}
+
+inline Vespa_view_halfedge halfedge(Vespa_view_edge e, const Vespa_view&)
+{
+  return e.halfedge();
+}
+
+inline Vespa_view_edge edge(Vespa_view_halfedge h, const Vespa_view& g)
+{
+  const vtkIdType o = g.opposite(h.idx());
+  return Vespa_view_edge(Vespa_view_halfedge(o < h.idx() ? o : h.idx()));
+}
+
+inline Vespa_view_vertex source(Vespa_view_edge e, const Vespa_view& g)
+{
+  return source(e.halfedge(), g);
+}
+
+inline Vespa_view_vertex target(Vespa_view_edge e, const Vespa_view& g)
+{
+  return target(e.halfedge(), g);
+}
+
+inline std::pair<Vespa_view_halfedge, bool> halfedge(
+  Vespa_view_vertex u, Vespa_view_vertex v, const Vespa_view& g)
+{
+  const vtkIdType start = g.halfedge_of_vertex(v.idx());
+  if (start < 0)
+  {
+    return std::make_pair(Vespa_view_halfedge(), false);
+  }
+  // turn around v using incoming halfedges
+  vtkIdType h = start;
+  do
+  {
+    if (g.source(h) == u.idx())
+    {
+      return std::make_pair(Vespa_view_halfedge(h), true);
+    }
+    h = g.opposite(g.next(h));
+  } while (h != start);
+
+  return std::make_pair(Vespa_view_halfedge(), false);
+}
+
+inline std::pair<Vespa_view_edge, bool> edge(
+  Vespa_view_vertex u, Vespa_view_vertex v, const Vespa_view& g)
+{
+  auto h = halfedge(u, v, g);
+  return std::make_pair(h.second ? edge(h.first, g) : Vespa_view_edge(), h.second);
+}
+
+inline std::size_t degree(Vespa_view_vertex v, const Vespa_view& g)
+{
+  const vtkIdType start = g.halfedge_of_vertex(v.idx());
+  if (start < 0)
+  {
+    return 0;
+  }
+  std::size_t res = 0;
+  vtkIdType   h   = start;
+  do
+  {
+    res++;
+    h = g.opposite(g.next(h));
+  } while (h != start);
+
+  return res;
+}
+
+inline std::size_t degree(Vespa_view_face, const Vespa_view&)
+{
+  return 3;
+}
+
+inline std::size_t out_degree(Vespa_view_vertex v, const Vespa_view& g)
+{
+  return degree(v, g);
+}
+
+inline std::size_t in_degree(Vespa_view_vertex v, const Vespa_view& g)
+{
+  return degree(v, g);
+}
+
+inline CGAL::Iterator_range<CGAL::Out_edge_iterator<Vespa_view>> out_edges(
+  Vespa_view_vertex v, const Vespa_view& g)
+{
+  using It = CGAL::Out_edge_iterator<Vespa_view>;
+  return CGAL::make_range(It(halfedge(v, g), g), It(halfedge(v, g), g, 1));
+}
+
+inline CGAL::Iterator_range<CGAL::In_edge_iterator<Vespa_view>> in_edges(
+  Vespa_view_vertex v, const Vespa_view& g)
+{
+  using It = CGAL::In_edge_iterator<Vespa_view>;
+  return CGAL::make_range(It(halfedge(v, g), g), It(halfedge(v, g), g, 1));
+}
+
+// Property maps
+// -------------
+
+/**
+ * Readable vertex point map: reads coordinates in the vtkPoints buffer.
+ */
+struct Vespa_view_point_map
+{
+  using key_type   = Vespa_view_vertex;
+  using value_type = CGAL_Kernel::Point_3;
+  using reference  = value_type;
+  using category   = boost::readable_property_map_tag;
+
+  const Vespa_view* view = nullptr;
+
+  friend value_type get(const Vespa_view_point_map& map, key_type v)
+  {
+    return map.view->point(v.idx());
+  }
+};
+
+/**
+ * Readable index map for the vertices, halfedges and faces of the view.
+ */
+template <typename Descriptor>
+struct Vespa_view_index_map
+{
+  using key_type   = Descriptor;
+  using value_type = std::size_t;
+  using reference  = std::size_t;
+  using category   = boost::readable_property_map_tag;
+
+  friend value_type get(const Vespa_view_index_map&, key_type d)
+  {
+    return static_cast<value_type>(d.idx());
+  }
+};
+
+namespace boost
+{
+template <>
+struct property_map<Vespa_view, CGAL::vertex_point_t>
+{
+  using type       = Vespa_view_point_map;
+  using const_type = Vespa_view_point_map;
+};
+template <>
+struct property_map<const Vespa_view, CGAL::vertex_point_t>
+  : public property_map<Vespa_view, CGAL::vertex_point_t>
+{
+};
+
+template <>
+struct property_map<Vespa_view, CGAL::vertex_index_t>
+{
+  using type       = Vespa_view_index_map<Vespa_view_vertex>;
+  using const_type = type;
+};
+template <>
+struct property_map<const Vespa_view, CGAL::vertex_index_t>
+  : public property_map<Vespa_view, CGAL::vertex_index_t>
+{
+};
+
+template <>
+struct property_map<Vespa_view, CGAL::halfedge_index_t>
+{
+  using type       = Vespa_view_index_map<Vespa_view_halfedge>;
+  using const_type = type;
+};
+template <>
+struct property_map<const Vespa_view, CGAL::halfedge_index_t>
+  : public property_map<Vespa_view, CGAL::halfedge_index_t>
+{
+};
+
+template <>
+struct property_map<Vespa_view, CGAL::face_index_t>
+{
+  using type       = Vespa_view_index_map<Vespa_view_face>;
+  using const_type = type;
+};
+template <>
+struct property_map<const Vespa_view, CGAL::face_index_t>
+  : public property_map<Vespa_view, CGAL::face_index_t>
+{
+};
+} // namespace boost
+
+namespace CGAL
+{
+template <>
+struct graph_has_property<Vespa_view, vertex_point_t> : public CGAL::Tag_true
+{
+};
+template <>
+struct graph_has_property<Vespa_view, vertex_index_t> : public CGAL::Tag_true
+{
+};
+template <>
+struct graph_has_property<Vespa_view, halfedge_index_t> : public CGAL::Tag_true
+{
+};
+template <>
+struct graph_has_property<Vespa_view, face_index_t> : public CGAL::Tag_true
+{
+};
+} // namespace CGAL
+
+inline Vespa_view_point_map get(CGAL::vertex_point_t, const Vespa_view& g)
+{
+  Vespa_view_point_map map;
+  map.view = &g;
+  return map;
+}
+
+inline Vespa_view_point_map::value_type get(
+  CGAL::vertex_point_t, const Vespa_view& g, Vespa_view_vertex v)
+{
+  return g.point(v.idx());
+}
+
+inline Vespa_view_index_map<Vespa_view_vertex> get(CGAL::vertex_index_t, const Vespa_view&)
+{
+  return Vespa_view_index_map<Vespa_view_vertex>();
+}
+
+inline Vespa_view_index_map<Vespa_view_halfedge> get(CGAL::halfedge_index_t, const Vespa_view&)
+{
+  return Vespa_view_index_map<Vespa_view_halfedge>();
+}
+
+inline Vespa_view_index_map<Vespa_view_face> get(CGAL::face_index_t, const Vespa_view&)
+{
+  return Vespa_view_index_map<Vespa_view_face>();
+}
+
+namespace std
+{
+template <typename Tag>
+struct hash<Vespa_view_index<Tag>>
+{
+  std::size_t operator()(const Vespa_view_index<Tag>& i) const
+  {
+    return std::hash<vtkIdType>()(i.idx());
+  }
+};
+
+template <>
+struct hash<Vespa_view_edge>
+{
+  std::size_t operator()(const Vespa_view_edge& e) const
+  {
+    return std::hash<vtkIdType>()(e.idx());
+  }
+};
+} // namespace std
+
+#endif
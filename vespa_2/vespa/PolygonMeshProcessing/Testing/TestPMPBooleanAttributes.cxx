@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "vtkCell.h"
+#include "vtkCellData.h"
+#include "vtkCleanPolyData.h"
+#include "vtkCubeSource.h"
+#include "vtkDoubleArray.h"
+#include "vtkIdTypeArray.h"
+#include "vtkNew.h"
+#include "vtkPointData.h"
+#include "vtkPolyData.h"
+#include "vtkSphereSource.h"
+#include "vtkTriangleFilter.h"
+
+#include "vtkCGALBooleanOperation.h"
+
+namespace
+{
+double linear(const double p[3])
+{
+  return p[0] + 2. * p[1] + 3. * p[2];
+}
+
+// Cube cutting the sphere around (1, 0, 0)
+const double Center[3] = { 1., 0., 0. };
+const double Half      = 0.2;
+
+bool onCubeFace(const double p[3])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    if (std::abs(std::abs(p[i] - Center[i]) - Half) < 1e-6)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool isCubeCorner(const double p[3])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    if (std::abs(std::abs(p[i] - Center[i]) - Half) > 1e-6)
+    {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+int TestPMPBooleanAttributes(int, char*[])
+{
+  // Sphere with a linear point field and the input cell ids
+  vtkNew<vtkSphereSource> sphere;
+  sphere->SetPhiResolution(16);
+  sphere->SetThetaResolution(16);
+  sphere->Update();
+
+  vtkNew<vtkPolyData> input;
+  input->ShallowCopy(sphere->GetOutput());
+  const vtkIdType nbInputCells = input->GetNumberOfCells();
+
+  vtkNew<vtkDoubleArray> field;
+  field->SetName("Linear");
+  field->SetNumberOfTuples(input->GetNumberOfPoints());
+  double range[2] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+  for (vtkIdType pid = 0; pid < input->GetNumberOfPoints(); pid++)
+  {
+    const double value = ::linear(input->GetPoint(pid));
+    field->SetValue(pid, value);
+    range[0] = std::min(range[0], value);
+    range[1] = std::max(range[1], value);
+  }
+  input->GetPointData()->AddArray(field);
+
+  vtkNew<vtkIdTypeArray> cellIds;
+  cellIds->SetName("InputCellId");
+  cellIds->SetNumberOfTuples(nbInputCells);
+  for (vtkIdType cid = 0; cid < nbInputCells; cid++)
+  {
+    cellIds->SetValue(cid, cid);
+  }
+  input->GetCellData()->AddArray(cellIds);
+
+  vtkNew<vtkCubeSource> cube;
+  cube->SetCenter(Center[0], Center[1], Center[2]);
+  cube->SetXLength(2. * Half);
+  cube->SetYLength(2. * Half);
+  cube->SetZLength(2. * Half);
+  vtkNew<vtkTriangleFilter> triangles;
+  triangles->SetInputConnection(cube->GetOutputPort());
+  // merge the points duplicated on the cube faces to close it
+  vtkNew<vtkCleanPolyData> closedCube;
+  closedCube->SetInputConnection(triangles->GetOutputPort());
+
+  vtkNew<vtkCGALBooleanOperation> boolOp;
+  boolOp->SetInputData(input);
+  boolOp->SetSourceConnection(closedCube->GetOutputPort());
+  boolOp->SetOperationType(vtkCGALBooleanOperation::DIFFERENCE);
+
+  for (bool local : { true, false })
+  {
+    boolOp->SetLocalCorefinement(local);
+    boolOp->Update();
+    vtkPolyData* output = boolOp->GetOutput();
+
+    auto outField = vtkDoubleArray::SafeDownCast(output->GetPointData()->GetArray("Linear"));
+    auto outCellIds =
+      vtkIdTypeArray::SafeDownCast(output->GetCellData()->GetArray("InputCellId"));
+    if (!outField || !outCellIds || output->GetNumberOfCells() <= nbInputCells)
+    {
+      std::cerr << "Missing attributes or cut, local: " << local << std::endl;
+      return 1;
+    }
+
+    // The kept and new points on the sphere are copied or interpolated in
+    // their input triangle, which is exact for a linear field. The corners
+    // of the cube inside the sphere take the values of their neighbors.
+    vtkIdType nbCorners = 0;
+    for (vtkIdType pid = 0; pid < output->GetNumberOfPoints(); pid++)
+    {
+      double p[3];
+      output->GetPoint(pid, p);
+      const double value = outField->GetValue(pid);
+      if (::isCubeCorner(p))
+      {
+        nbCorners++;
+        if (value < range[0] || value > range[1])
+        {
+          std::cerr << "Cube corner " << pid << " out of the input range: " << value
+                    << std::endl;
+          return 1;
+        }
+      }
+      else if (std::abs(value - ::linear(p)) > 1e-5)
+      {
+        std::cerr << "Wrong value on point " << pid << ": " << value << " instead of "
+                  << ::linear(p) << ", local: " << local << std::endl;
+        return 1;
+      }
+    }
+    if (nbCorners != 4)
+    {
+      std::cerr << "Expected the 4 inner cube corners, got " << nbCorners << std::endl;
+      return 1;
+    }
+
+    // The pieces of a split input face keep its cell data
+    for (vtkIdType cid = 0; cid < output->GetNumberOfCells(); cid++)
+    {
+      const vtkIdType origin = outCellIds->GetValue(cid);
+      if (origin < 0 || origin >= nbInputCells)
+      {
+        std::cerr << "Wrong input cell id " << origin << " on cell " << cid << std::endl;
+        return 1;
+      }
+
+      vtkCell* cell        = output->GetCell(cid);
+      double   centroid[3] = { 0., 0., 0. };
+      bool     inCube      = true;
+      for (vtkIdType i = 0; i < cell->GetNumberOfPoints(); i++)
+      {
+        double p[3];
+        output->GetPoint(cell->GetPointId(i), p);
+        inCube = inCube && ::onCubeFace(p);
+        for (int k = 0; k < 3; k++)
+        {
+          centroid[k] += p[k] / cell->GetNumberOfPoints();
+        }
+      }
+      if (inCube)
+      {
+        continue; // face of the cube
+      }
+
+      double closest[3], pcoords[3], dist2, weights[3];
+      int    subId;
+      if (input->GetCell(origin)->EvaluatePosition(
+            centroid, closest, subId, pcoords, dist2, weights) != 1 ||
+        dist2 > 1e-10)
+      {
+        std::cerr << "Cell " << cid << " is not a piece of its input cell " << origin
+                  << ", local: " << local << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
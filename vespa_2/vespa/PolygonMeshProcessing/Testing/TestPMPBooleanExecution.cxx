@@ -1,7 +1,12 @@
+#include <cmath>
 #include <iostream>
 
+#include "vtkFieldData.h"
+#include "vtkMultiBlockDataSet.h"
 #include "vtkNew.h"
+#include "vtkPolyData.h"
 #include "vtkSphereSource.h"
+#include "vtkStringArray.h"
 #include "vtkTestUtilities.h"
 #include "vtkXMLPolyDataReader.h"
 #include "vtkXMLPolyDataWriter.h"
@@ -40,5 +45,175 @@ int TestPMPBooleanExecution(int, char* argv[])
   writer->SetFileName("boolean_operation_union.vtp");
   writer->Write();
 
+  // Compare with the corefinement of the whole meshes
+  vtkNew<vtkCGALBooleanOperation> fullOp;
+  fullOp->SetInputConnection(reader->GetOutputPort());
+  fullOp->SetSourceConnection(sphere->GetOutputPort());
+  fullOp->LocalCorefinementOff();
+  for (int op = vtkCGALBooleanOperation::DIFFERENCE; op <= vtkCGALBooleanOperation::UNION; op++)
+  {
+    boolOp->SetOperationType(op);
+    boolOp->Update();
+    fullOp->SetOperationType(op);
+    fullOp->Update();
+
+    vtkPolyData* local = boolOp->GetOutput();
+    vtkPolyData* full  = fullOp->GetOutput();
+    if (local->GetNumberOfCells() != full->GetNumberOfCells())
+    {
+      std::cerr << "Local and full corefinement differ for operation " << op << ": "
+                << local->GetNumberOfCells() << " and " << full->GetNumberOfCells() << " cells"
+                << std::endl;
+      return 1;
+    }
+    double localBounds[6], fullBounds[6];
+    local->GetBounds(localBounds);
+    full->GetBounds(fullBounds);
+    for (int i = 0; i < 6; i++)
+    {
+      if (std::abs(localBounds[i] - fullBounds[i]) > 1e-6 * full->GetLength())
+      {
+        std::cerr << "Local and full corefinement bounds differ for operation " << op
+                  << std::endl;
+        return 1;
+      }
+    }
+  }
+
+  // Disjoint meshes are combined without corefinement
+  reader->Update();
+  sphere->Update();
+  const vtkIdType nbInputCells  = reader->GetOutput()->GetNumberOfCells();
+  const vtkIdType nbSourceCells = sphere->GetOutput()->GetNumberOfCells();
+  const vtkIdType expected[3]   = { nbInputCells, 0, nbInputCells + nbSourceCells };
+  sphere->SetCenter(100., 0., 0.);
+  for (int op = vtkCGALBooleanOperation::DIFFERENCE; op <= vtkCGALBooleanOperation::UNION; op++)
+  {
+    boolOp->SetOperationType(op);
+    boolOp->Update();
+    if (boolOp->GetOutput()->GetNumberOfCells() != expected[op])
+    {
+      std::cerr << "Wrong result for disjoint meshes and operation " << op << ": "
+                << boolOp->GetOutput()->GetNumberOfCells() << " cells instead of "
+                << expected[op] << std::endl;
+      return 1;
+    }
+  }
+
+  // A copy of the source gives the same result, from the cached source
+  vtkNew<vtkPolyData> sphereCopy;
+  sphereCopy->DeepCopy(sphere->GetOutput());
+  boolOp->SetInputData(1, sphereCopy);
+  boolOp->Update();
+  if (boolOp->GetOutput()->GetNumberOfCells() != expected[vtkCGALBooleanOperation::UNION])
+  {
+    std::cerr << "Wrong result with a copy of the source" << std::endl;
+    return 1;
+  }
+  boolOp->ReleaseSourceCache();
+
+  // Union with all the blocks of a composite source
+  vtkNew<vtkSphereSource> first;
+  first->SetPhiResolution(16);
+  first->SetThetaResolution(16);
+  vtkNew<vtkMultiBlockDataSet> segments;
+  segments->SetNumberOfBlocks(5);
+  for (unsigned int i = 0; i < 5; i++)
+  {
+    vtkNew<vtkSphereSource> segment;
+    segment->SetCenter(0.3 * (i + 1), 0., 0.);
+    segment->SetPhiResolution(16);
+    segment->SetThetaResolution(16);
+    segment->Update();
+    segments->SetBlock(i, segment->GetOutput());
+  }
+
+  vtkNew<vtkCGALBooleanOperation> unionOp;
+  unionOp->SetInputConnection(first->GetOutputPort());
+  unionOp->SetInputData(1, segments);
+  unionOp->SetOperationType(vtkCGALBooleanOperation::UNION);
+  unionOp->Update();
+
+  double bounds[6];
+  unionOp->GetOutput()->GetBounds(bounds);
+  if (unionOp->GetOutput()->GetNumberOfCells() == 0 || std::abs(bounds[0] + 0.5) > 1e-3 ||
+    std::abs(bounds[1] - 2.) > 1e-3)
+  {
+    std::cerr << "Wrong union of the composite source, bounds along x: " << bounds[0] << ", "
+              << bounds[1] << std::endl;
+    return 1;
+  }
+
+  // Difference with all the blocks of a composite source in one pass:
+  // separate holes, two overlapping cutters and an inner cavity
+  vtkNew<vtkSphereSource> body;
+  body->SetRadius(2.);
+  body->SetPhiResolution(32);
+  body->SetThetaResolution(32);
+  const double cutters[5][4] = { { 2., 0., 0., 0.3 }, { -2., 0., 0., 0.3 }, { 0., 2., 0., 0.3 },
+    { 0.2, 2.1, 0., 0.3 }, { 0., 0., 0., 0.5 } };
+  vtkNew<vtkMultiBlockDataSet> tools;
+  tools->SetNumberOfBlocks(5);
+  for (unsigned int i = 0; i < 5; i++)
+  {
+    vtkNew<vtkSphereSource> cutter;
+    cutter->SetCenter(cutters[i][0], cutters[i][1], cutters[i][2]);
+    cutter->SetRadius(cutters[i][3]);
+    cutter->Update();
+    tools->SetBlock(i, cutter->GetOutput());
+  }
+
+  vtkNew<vtkCGALBooleanOperation> drillOp;
+  drillOp->SetInputConnection(body->GetOutputPort());
+  drillOp->SetInputData(1, tools);
+  drillOp->SetOperationType(vtkCGALBooleanOperation::DIFFERENCE);
+  drillOp->Update();
+  vtkNew<vtkCGALBooleanOperation> fullDrillOp;
+  fullDrillOp->SetInputConnection(body->GetOutputPort());
+  fullDrillOp->SetInputData(1, tools);
+  fullDrillOp->SetOperationType(vtkCGALBooleanOperation::DIFFERENCE);
+  fullDrillOp->LocalCorefinementOff();
+  fullDrillOp->Update();
+  if (drillOp->GetOutput()->GetNumberOfCells() == 0 ||
+    drillOp->GetOutput()->GetNumberOfCells() != fullDrillOp->GetOutput()->GetNumberOfCells())
+  {
+    std::cerr << "Wrong difference with the composite source: "
+              << drillOp->GetOutput()->GetNumberOfCells() << " cells instead of "
+              << fullDrillOp->GetOutput()->GetNumberOfCells() << std::endl;
+    return 1;
+  }
+
+  // An open input does not bound a volume to locate the pieces in, the whole
+  // meshes are corefined instead, with a single or a composite source
+  vtkNew<vtkSphereSource> openBody;
+  openBody->SetRadius(2.);
+  openBody->SetEndPhi(150.);
+  vtkNew<vtkSphereSource> cutter;
+  cutter->SetCenter(0., 0., 2.);
+  cutter->SetRadius(0.5);
+  cutter->Update();
+  vtkNew<vtkMultiBlockDataSet> cutters;
+  cutters->SetNumberOfBlocks(1);
+  cutters->SetBlock(0, cutter->GetOutput());
+
+  vtkNew<vtkCGALBooleanOperation> openOp;
+  openOp->SetInputConnection(openBody->GetOutputPort());
+  openOp->SetOperationType(vtkCGALBooleanOperation::DIFFERENCE);
+  openOp->ReportTimingsOn();
+  for (vtkDataObject* source : { static_cast<vtkDataObject*>(cutter->GetOutput()),
+         static_cast<vtkDataObject*>(cutters.Get()) })
+  {
+    openOp->SetInputData(1, source);
+    openOp->Update();
+    auto stages = vtkStringArray::SafeDownCast(
+      openOp->GetOutput()->GetFieldData()->GetAbstractArray("vtkCGALStageNames"));
+    if (!stages || stages->LookupValue("extract patch") >= 0 ||
+      stages->LookupValue("localize tools") >= 0)
+    {
+      std::cerr << "The open input was corefined locally" << std::endl;
+      return 1;
+    }
+  }
+
   return 0;
 }
@@ -0,0 +1,640 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <vtkAppendPolyData.h>
+#include <vtkCallbackCommand.h>
+#include <vtkCommand.h>
+#include <vtkDataArray.h>
+#include <vtkExecutive.h>
+#include <vtkFieldData.h>
+#include <vtkIdTypeArray.h>
+#include <vtkMultiBlockDataSet.h>
+#include <vtkNew.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkPolyData.h>
+#include <vtkSelection.h>
+#include <vtkSelectionNode.h>
+#include <vtkStringArray.h>
+#include <vtkTestUtilities.h>
+#include <vtkXMLPolyDataWriter.h>
+#include <vtksys/Directory.hxx>
+#include <vtksys/SystemTools.hxx>
+
+#include "vtkCGALMeshDeformation.h"
+#include "vtkCGALVesselTreeSource.h"
+
+namespace
+{
+// Whether the points match up to the tolerance, reporting the first one that does not
+bool samePoints(
+  vtkPoints* pts1, vtkPoints* pts2, const std::string& what, double tolerance = 1e-6)
+{
+  for (vtkIdType i = 0; i < pts1->GetNumberOfPoints(); i++)
+  {
+    double p[3], q[3];
+    pts1->GetPoint(i, p);
+    pts2->GetPoint(i, q);
+    if (std::abs(p[0] - q[0]) + std::abs(p[1] - q[1]) + std::abs(p[2] - q[2]) > tolerance)
+    {
+      std::cerr << what << " differs at point " << i << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Number of elements of the stage in the last update, -1 if it did not run
+double stageElements(vtkCGALMeshDeformation* deformer, const char* name)
+{
+  vtkFieldData*   fd       = deformer->GetOutput()->GetFieldData();
+  vtkDataArray*   elements = fd->GetArray("vtkCGALStageElements");
+  vtkStringArray* stages =
+    vtkStringArray::SafeDownCast(fd->GetAbstractArray("vtkCGALStageNames"));
+  const vtkIdType stage = stages ? stages->LookupValue(name) : -1;
+  return elements && stage >= 0 ? elements->GetTuple1(stage) : -1.;
+}
+
+// Move the points along Y
+void translate(vtkPolyData* targets, double dy)
+{
+  for (vtkIdType i = 0; i < targets->GetNumberOfPoints(); i++)
+  {
+    double p[3];
+    targets->GetPoint(i, p);
+    p[1] += dy;
+    targets->GetPoints()->SetPoint(i, p);
+  }
+  targets->GetPoints()->Modified();
+}
+
+// Add the renumbered IDs of the points of the mesh and of the control points
+void renumber(vtkPolyData* mesh, vtkPolyData* controls, const char* idName,
+  const std::vector<vtkIdType>& newIds)
+{
+  vtkNew<vtkIdTypeArray> meshIds;
+  meshIds->SetName("RenumberedIds");
+  meshIds->SetNumberOfValues(mesh->GetNumberOfPoints());
+  for (vtkIdType pid = 0; pid < mesh->GetNumberOfPoints(); pid++)
+  {
+    meshIds->SetValue(pid, newIds[pid]);
+  }
+  mesh->GetPointData()->AddArray(meshIds);
+
+  vtkDataArray*          oldIds = controls->GetPointData()->GetArray(idName);
+  vtkNew<vtkIdTypeArray> controlIds;
+  controlIds->SetName("RenumberedIds");
+  controlIds->SetNumberOfValues(controls->GetNumberOfPoints());
+  for (vtkIdType i = 0; i < controls->GetNumberOfPoints(); i++)
+  {
+    controlIds->SetValue(i, newIds[static_cast<vtkIdType>(oldIds->GetTuple1(i))]);
+  }
+  controls->GetPointData()->AddArray(controlIds);
+}
+
+// A point at the given number of edges from the ROI
+vtkIdType pointAroundRoi(vtkPolyData* mesh, vtkIdTypeArray* roi, int nbEdges)
+{
+  vtkNew<vtkPolyData> linked;
+  linked->ShallowCopy(mesh);
+  linked->BuildLinks();
+
+  std::vector<int>       distance(mesh->GetNumberOfPoints(), -1);
+  std::vector<vtkIdType> ring;
+  for (vtkIdType i = 0; i < roi->GetNumberOfValues(); i++)
+  {
+    distance[roi->GetValue(i)] = 0;
+    ring.emplace_back(roi->GetValue(i));
+  }
+  for (int d = 1; d <= nbEdges; d++)
+  {
+    std::vector<vtkIdType> nextRing;
+    for (vtkIdType pid : ring)
+    {
+      vtkIdType  nbCells;
+      vtkIdType* cells;
+      linked->GetPointCells(pid, nbCells, cells);
+      for (vtkIdType c = 0; c < nbCells; c++)
+      {
+        vtkIdType        npts;
+        const vtkIdType* pts;
+        linked->GetCellPoints(cells[c], npts, pts);
+        for (vtkIdType i = 0; i < npts; i++)
+        {
+          if (distance[pts[i]] < 0)
+          {
+            distance[pts[i]] = d;
+            nextRing.emplace_back(pts[i]);
+          }
+        }
+      }
+    }
+    ring.swap(nextRing);
+  }
+  return ring.empty() ? -1 : ring.front();
+}
+
+// Number of factorization files in the directory
+unsigned long numberOfCachedFiles(const std::string& directory)
+{
+  vtksys::Directory dir;
+  dir.Load(directory);
+  unsigned long nbFiles = 0;
+  for (unsigned long i = 0; i < dir.GetNumberOfFiles(); i++)
+  {
+    const std::string name = dir.GetFile(i);
+    nbFiles += vtksys::SystemTools::GetFilenameLastExtension(name) == ".vlu" ? 1 : 0;
+  }
+  return nbFiles;
+}
+
+// Write an out of range index at the start of the row permutation of each
+// factorization file, after the magic, the header, the key, the 5 sizes and
+// the size of the permutation
+void tamperCachedFiles(const std::string& directory)
+{
+  vtksys::Directory dir;
+  dir.Load(directory);
+  for (unsigned long i = 0; i < dir.GetNumberOfFiles(); i++)
+  {
+    const std::string name = dir.GetFile(i);
+    if (vtksys::SystemTools::GetFilenameLastExtension(name) != ".vlu")
+    {
+      continue;
+    }
+    std::fstream file(directory + "/" + name, std::ios::in | std::ios::out | std::ios::binary);
+    const int    index = 1 << 30;
+    file.seekp(8 + 8 + 8 + 5 * 8 + 8);
+    file.write(reinterpret_cast<const char*>(&index), sizeof(index));
+  }
+}
+}
+
+int TestPMPDeformVesselTree(int argc, char* argv[])
+{
+  // Vessel tree with control points on its last branch
+
+  vtkNew<vtkCGALVesselTreeSource> tree;
+  tree->SetBifurcationDepth(3);
+  tree->SetResolution(3);
+  tree->Update();
+  vtkPolyData* surface  = tree->GetOutput();
+  vtkPolyData* controls = tree->GetControlPointsOutput();
+  const double radius   = 2. * tree->GetRootRadius();
+
+  // Deform the last branch
+
+  vtkNew<vtkPolyData> targets;
+  targets->DeepCopy(tree->GetControlPointsOutput());
+
+  vtkNew<vtkCGALMeshDeformation> deformer;
+  deformer->SetInputConnection(0, tree->GetOutputPort(0));
+  deformer->SetInputData(1, targets);
+  deformer->SetInputConnection(2, tree->GetOutputPort(1));
+  deformer->ReportTimingsOn();
+  deformer->Update();
+
+  // Moving the targets again reuses the factorized system
+
+  ::translate(targets, 0.5);
+  deformer->Update();
+  if (::stageElements(deformer, "deform") < 0 || ::stageElements(deformer, "preprocess") >= 0)
+  {
+    std::cerr << "The deformation system was not reused" << std::endl;
+    return 1;
+  }
+
+  // With every solver backend, a reused session factorizes nothing and iterates
+  // from its previous result to the deformation of a new session
+
+  for (int backend : { vtkCGALMeshDeformation::DIRECT_SOLVER,
+         vtkCGALMeshDeformation::PARALLEL_DIRECT_SOLVER, vtkCGALMeshDeformation::ITERATIVE_SOLVER })
+  {
+    vtkNew<vtkPolyData> backendTargets;
+    backendTargets->DeepCopy(controls);
+
+    vtkNew<vtkCGALMeshDeformation> sessionDeformer;
+    vtkNew<vtkCGALMeshDeformation> newDeformer;
+    for (vtkCGALMeshDeformation* filter : { sessionDeformer.Get(), newDeformer.Get() })
+    {
+      filter->SetInputConnection(0, tree->GetOutputPort(0));
+      filter->SetInputData(1, backendTargets);
+      filter->SetInputConnection(2, tree->GetOutputPort(1));
+      filter->SetSolverBackend(backend);
+      filter->SetNumberOfIterations(200);
+      filter->SetTolerance(1e-6);
+    }
+    sessionDeformer->Update();
+    const unsigned int nbFactorizations = sessionDeformer->GetNumberOfFactorizations();
+
+    ::translate(backendTargets, 0.5);
+    sessionDeformer->Update();
+    newDeformer->Update();
+
+    if (nbFactorizations == 0 || sessionDeformer->GetNumberOfFactorizations() != 0)
+    {
+      std::cerr << "Solver backend " << backend << " factorized " << nbFactorizations
+                << " systems, then " << sessionDeformer->GetNumberOfFactorizations()
+                << " when reused" << std::endl;
+      return 1;
+    }
+    if (!::samePoints(newDeformer->GetOutput()->GetPoints(),
+          sessionDeformer->GetOutput()->GetPoints(),
+          "The reused session of solver backend " + std::to_string(backend), 1e-3))
+    {
+      return 1;
+    }
+  }
+
+  // Without selection, grow the ROI around the control points
+
+  vtkNew<vtkCGALMeshDeformation> radiusDeformer;
+  radiusDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+  radiusDeformer->SetInputData(1, controls);
+  radiusDeformer->SetRoiRadius(radius);
+  radiusDeformer->ReportTimingsOn();
+  radiusDeformer->Update();
+
+  // the ROI is larger than the control points but does not reach the whole tree
+  const double roiSize = ::stageElements(radiusDeformer, "deform");
+  if (::stageElements(radiusDeformer, "grow ROI") < 0 ||
+    roiSize <= controls->GetNumberOfPoints() || roiSize >= surface->GetNumberOfPoints())
+  {
+    std::cerr << "Unexpected ROI of " << roiSize << " points around the control points"
+              << std::endl;
+    return 1;
+  }
+
+  // Deforming the cells around the ROI and its 1-ring gives the same result as the
+  // whole mesh
+
+  for (bool grown : { false, true })
+  {
+    vtkNew<vtkCGALMeshDeformation> globalDeformer;
+    vtkNew<vtkCGALMeshDeformation> localDeformer;
+    for (vtkCGALMeshDeformation* filter : { globalDeformer.Get(), localDeformer.Get() })
+    {
+      filter->SetInputConnection(0, tree->GetOutputPort(0));
+      filter->SetInputData(1, controls);
+      if (grown)
+      {
+        filter->SetRoiRadius(radius);
+      }
+      else
+      {
+        filter->SetInputConnection(2, tree->GetOutputPort(1));
+      }
+    }
+    localDeformer->LocalDeformationOn();
+    globalDeformer->Update();
+    localDeformer->Update();
+
+    if (!::samePoints(globalDeformer->GetOutput()->GetPoints(),
+          localDeformer->GetOutput()->GetPoints(),
+          grown ? "Local deformation of a grown ROI" : "Local deformation of a selected ROI"))
+    {
+      return 1;
+    }
+  }
+
+  // IDs offset from the indices, then shuffled, are looked up in the hash index
+
+  const vtkIdType        nbPoints = surface->GetNumberOfPoints();
+  std::vector<vtkIdType> offsetIds(nbPoints);
+  std::iota(offsetIds.begin(), offsetIds.end(), 1000);
+  std::vector<vtkIdType> shuffledIds = offsetIds;
+  std::shuffle(shuffledIds.begin(), shuffledIds.end(), std::mt19937(42));
+
+  vtkNew<vtkPolyData> renumberedMesh;
+  vtkNew<vtkPolyData> renumberedControls;
+  for (const std::vector<vtkIdType>* newIds : { &offsetIds, &shuffledIds })
+  {
+    renumberedMesh->DeepCopy(surface);
+    renumberedControls->DeepCopy(controls);
+    ::renumber(renumberedMesh, renumberedControls, tree->GetGlobalIdArray().c_str(), *newIds);
+
+    vtkNew<vtkCGALMeshDeformation> idsDeformer;
+    idsDeformer->SetInputData(0, renumberedMesh);
+    idsDeformer->SetInputData(1, renumberedControls);
+    idsDeformer->SetRoiRadius(radius);
+    idsDeformer->SetGlobalIdArray("RenumberedIds");
+    idsDeformer->Update();
+
+    if (!::samePoints(radiusDeformer->GetOutput()->GetPoints(),
+          idsDeformer->GetOutput()->GetPoints(),
+          newIds == &offsetIds ? "Deformation with offset IDs" : "Deformation with shuffled IDs"))
+    {
+      return 1;
+    }
+  }
+
+  // A duplicated ID is rejected, the errors of the filter and of its executive are expected
+
+  std::vector<vtkIdType> duplicatedIds = shuffledIds;
+  duplicatedIds[nbPoints - 1]          = duplicatedIds[0];
+  renumberedMesh->DeepCopy(surface);
+  renumberedControls->DeepCopy(controls);
+  ::renumber(renumberedMesh, renumberedControls, tree->GetGlobalIdArray().c_str(), duplicatedIds);
+
+  bool                       rejected = false;
+  vtkNew<vtkCallbackCommand> onError;
+  onError->SetClientData(&rejected);
+  onError->SetCallback([](vtkObject*, unsigned long, void* clientData, void* callData) {
+    const char* message = static_cast<const char*>(callData);
+    if (message && std::strstr(message, "not unique"))
+    {
+      *static_cast<bool*>(clientData) = true;
+    }
+  });
+
+  vtkNew<vtkCGALMeshDeformation> duplicatedDeformer;
+  duplicatedDeformer->SetInputData(0, renumberedMesh);
+  duplicatedDeformer->SetInputData(1, renumberedControls);
+  duplicatedDeformer->SetRoiRadius(radius);
+  duplicatedDeformer->SetGlobalIdArray("RenumberedIds");
+  duplicatedDeformer->AddObserver(vtkCommand::ErrorEvent, onError);
+  duplicatedDeformer->GetExecutive()->AddObserver(vtkCommand::ErrorEvent, onError);
+  duplicatedDeformer->Update();
+  if (!rejected)
+  {
+    std::cerr << "The duplicated global ID was not rejected" << std::endl;
+    return 1;
+  }
+
+  // The first run stores the factorization in a new directory of the test
+  // temporary directory, the second one reads it back, the third one rejects
+  // the tampered file and factorizes again, all give the same result as
+  // without cache
+
+  char* tempDir =
+    vtkTestUtilities::GetArgOrEnvOrDefault("-T", argc, argv, "VTK_TEMP_DIR", "Testing/Temporary");
+  const std::string cacheDir = std::string(tempDir) + "/TestPMPDeformVesselTree";
+  delete[] tempDir;
+  vtksys::SystemTools::RemoveADirectory(cacheDir);
+  if (!vtksys::SystemTools::MakeDirectory(cacheDir))
+  {
+    std::cerr << "Could not create the cache directory " << cacheDir << std::endl;
+    return 1;
+  }
+
+  for (int run = 0; run < 3; run++)
+  {
+    if (run == 2)
+    {
+      ::tamperCachedFiles(cacheDir);
+    }
+
+    vtkNew<vtkCGALMeshDeformation> cachedDeformer;
+    cachedDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+    cachedDeformer->SetInputData(1, controls);
+    cachedDeformer->SetRoiRadius(radius);
+    cachedDeformer->SetFactorizationCacheDirectory(cacheDir);
+    cachedDeformer->Update();
+
+    const unsigned long nbFiles  = ::numberOfCachedFiles(cacheDir);
+    const unsigned int  nbLoaded = cachedDeformer->GetNumberOfLoadedFactorizations();
+    if (nbFiles == 0 || (run == 1 ? nbLoaded != nbFiles : nbLoaded != 0))
+    {
+      std::cerr << "Run " << run << " found " << nbFiles << " cached files and loaded "
+                << nbLoaded << " factorizations" << std::endl;
+      vtksys::SystemTools::RemoveADirectory(cacheDir);
+      return 1;
+    }
+    if (!::samePoints(radiusDeformer->GetOutput()->GetPoints(),
+          cachedDeformer->GetOutput()->GetPoints(), "Deformation with a cached factorization"))
+    {
+      vtksys::SystemTools::RemoveADirectory(cacheDir);
+      return 1;
+    }
+  }
+  vtksys::SystemTools::RemoveADirectory(cacheDir);
+
+  // Deforming a proxy solves a smaller system
+
+  vtkNew<vtkCGALMeshDeformation> proxyDeformer;
+  proxyDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+  proxyDeformer->SetInputData(1, controls);
+  proxyDeformer->SetRoiRadius(radius);
+  proxyDeformer->SetProxyRatio(0.25);
+  proxyDeformer->ReportTimingsOn();
+  proxyDeformer->Update();
+
+  const double proxySize = ::stageElements(proxyDeformer, "deform");
+  if (proxySize <= 0. || proxySize >= roiSize)
+  {
+    std::cerr << "The proxy (" << proxySize << " points) is not smaller than the ROI ("
+              << roiSize << " points)" << std::endl;
+    return 1;
+  }
+
+  // and still moves the controls to their targets
+
+  vtkDataArray* surfaceGids = surface->GetPointData()->GetArray(tree->GetGlobalIdArray().c_str());
+  vtkDataArray* controlGids = controls->GetPointData()->GetArray(tree->GetGlobalIdArray().c_str());
+  vtkPoints*    proxyPts    = proxyDeformer->GetOutput()->GetPoints();
+  for (vtkIdType i = 0; i < controls->GetNumberOfPoints(); i++)
+  {
+    vtkIdType pid = 0;
+    while (surfaceGids->GetTuple1(pid) != controlGids->GetTuple1(i))
+    {
+      pid++;
+    }
+    double p[3], q[3];
+    proxyPts->GetPoint(pid, p);
+    controls->GetPoint(i, q);
+    if (std::abs(p[0] - q[0]) + std::abs(p[1] - q[1]) + std::abs(p[2] - q[2]) > 1e-6)
+    {
+      std::cerr << "The proxy deformation does not move control point " << i << std::endl;
+      return 1;
+    }
+  }
+
+  // Distant ROI components, on the last and on the second branch, are deformed
+  // separately, with the same result
+
+  vtkNew<vtkCGALVesselTreeSource> otherTree;
+  otherTree->SetBifurcationDepth(3);
+  otherTree->SetResolution(3);
+  otherTree->SetControlBranch(1);
+  otherTree->Update();
+
+  vtkNew<vtkAppendPolyData> allControls;
+  allControls->AddInputData(controls);
+  allControls->AddInputData(otherTree->GetControlPointsOutput());
+
+  vtkNew<vtkCGALMeshDeformation> globalPartsDeformer;
+  vtkNew<vtkCGALMeshDeformation> partsDeformer;
+  for (vtkCGALMeshDeformation* filter : { globalPartsDeformer.Get(), partsDeformer.Get() })
+  {
+    filter->SetInputConnection(0, tree->GetOutputPort(0));
+    filter->SetInputConnection(1, allControls->GetOutputPort());
+    filter->SetRoiRadius(radius);
+    filter->SetTolerance(0.);
+  }
+  partsDeformer->LocalDeformationOn();
+  globalPartsDeformer->Update();
+  partsDeformer->Update();
+
+  if (!::samePoints(globalPartsDeformer->GetOutput()->GetPoints(),
+        partsDeformer->GetOutput()->GetPoints(), "Deformation by components"))
+  {
+    return 1;
+  }
+
+  // A control point 2 edges away from the ROI shares its fixed ring: both regions
+  // are deformed together, with the same result as the whole mesh
+
+  vtkIdTypeArray* roiIds = vtkIdTypeArray::SafeDownCast(
+    tree->GetROIOutput()->GetNode(0)->GetSelectionList());
+  const vtkIdType nearPid = ::pointAroundRoi(surface, roiIds, 2);
+  if (nearPid < 0)
+  {
+    std::cerr << "No point found 2 edges away from the ROI" << std::endl;
+    return 1;
+  }
+
+  vtkNew<vtkPolyData> nearControls;
+  nearControls->DeepCopy(controls);
+  double nearTarget[3];
+  surface->GetPoint(nearPid, nearTarget);
+  nearTarget[1] += 0.1 * tree->GetRootRadius();
+  nearControls->GetPoints()->InsertNextPoint(nearTarget);
+  vtkIdTypeArray::SafeDownCast(
+    nearControls->GetPointData()->GetArray(tree->GetGlobalIdArray().c_str()))
+    ->InsertNextValue(nearPid);
+
+  vtkNew<vtkCGALMeshDeformation> globalNearDeformer;
+  vtkNew<vtkCGALMeshDeformation> nearDeformer;
+  for (vtkCGALMeshDeformation* filter : { globalNearDeformer.Get(), nearDeformer.Get() })
+  {
+    filter->SetInputConnection(0, tree->GetOutputPort(0));
+    filter->SetInputData(1, nearControls);
+    filter->SetInputConnection(2, tree->GetOutputPort(1));
+    filter->SetTolerance(0.);
+  }
+  nearDeformer->LocalDeformationOn();
+  globalNearDeformer->Update();
+  nearDeformer->Update();
+
+  if (!::samePoints(globalNearDeformer->GetOutput()->GetPoints(),
+        nearDeformer->GetOutput()->GetPoints(), "Deformation of nearby components"))
+  {
+    return 1;
+  }
+
+  // A batch of target sets gives one mesh per set, each deformed from the rest shape
+
+  vtkNew<vtkPolyData> otherTargets;
+  otherTargets->DeepCopy(controls);
+  for (vtkIdType i = 0; i < otherTargets->GetNumberOfPoints(); i++)
+  {
+    double p[3];
+    otherTargets->GetPoint(i, p);
+    p[2] += 0.5;
+    otherTargets->GetPoints()->SetPoint(i, p);
+  }
+
+  vtkNew<vtkMultiBlockDataSet> targetSets;
+  targetSets->SetNumberOfBlocks(2);
+  targetSets->SetBlock(0, controls);
+  targetSets->SetBlock(1, otherTargets);
+
+  vtkNew<vtkCGALMeshDeformation> batchDeformer;
+  batchDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+  batchDeformer->SetInputData(1, targetSets);
+  batchDeformer->SetRoiRadius(radius);
+  batchDeformer->Update();
+
+  auto* batch = vtkMultiBlockDataSet::SafeDownCast(batchDeformer->GetOutputDataObject(0));
+  if (!batch || batch->GetNumberOfBlocks() != 2)
+  {
+    std::cerr << "The batch did not give a mesh per set of targets" << std::endl;
+    return 1;
+  }
+
+  for (unsigned int set = 0; set < 2; set++)
+  {
+    vtkNew<vtkCGALMeshDeformation> setDeformer;
+    setDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+    setDeformer->SetInputData(1, vtkPolyData::SafeDownCast(targetSets->GetBlock(set)));
+    setDeformer->SetRoiRadius(radius);
+    setDeformer->Update();
+
+    vtkPolyData* block = vtkPolyData::SafeDownCast(batch->GetBlock(set));
+    if (!block)
+    {
+      std::cerr << "Block " << set << " of the batch is not a mesh" << std::endl;
+      return 1;
+    }
+    if (!::samePoints(setDeformer->GetOutput()->GetPoints(), block->GetPoints(),
+          "Batch deformation of set " + std::to_string(set)))
+    {
+      return 1;
+    }
+  }
+
+  // Each iteration fires a progress event with the current shape, aborting stops after it
+
+  vtkNew<vtkCGALMeshDeformation> abortedDeformer;
+  abortedDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+  abortedDeformer->SetInputData(1, controls);
+  abortedDeformer->SetRoiRadius(radius);
+  abortedDeformer->SetTolerance(0.);
+  abortedDeformer->IntermediateResultsOn();
+
+  int                        nbIterationEvents = 0;
+  vtkNew<vtkCallbackCommand> onProgress;
+  onProgress->SetClientData(&nbIterationEvents);
+  onProgress->SetCallback([](vtkObject* caller, unsigned long, void* clientData, void*) {
+    auto* filter = static_cast<vtkCGALMeshDeformation*>(caller);
+    if (filter->GetIteration() > 0 && filter->GetOutput()->GetNumberOfPoints() > 0)
+    {
+      (*static_cast<int*>(clientData))++;
+      filter->AbortExecuteOn();
+    }
+  });
+  abortedDeformer->AddObserver(vtkCommand::ProgressEvent, onProgress);
+  abortedDeformer->Update();
+
+  if (nbIterationEvents != 1 || abortedDeformer->GetIteration() != 1)
+  {
+    std::cerr << "The deformation was not interrupted after its first iteration ("
+              << nbIterationEvents << " events, " << abortedDeformer->GetIteration()
+              << " iterations)" << std::endl;
+    return 1;
+  }
+
+  // With the default tolerance, the iterations stop once the ROI barely moves
+
+  vtkNew<vtkCGALMeshDeformation> convergedDeformer;
+  convergedDeformer->SetInputConnection(0, tree->GetOutputPort(0));
+  convergedDeformer->SetInputData(1, controls);
+  convergedDeformer->SetRoiRadius(radius);
+  convergedDeformer->SetNumberOfIterations(50);
+  convergedDeformer->Update();
+
+  if (convergedDeformer->GetIteration() >= 50 ||
+    convergedDeformer->GetIterationChange() >= convergedDeformer->GetTolerance())
+  {
+    std::cerr << "The deformation did not converge: change of "
+              << convergedDeformer->GetIterationChange() << " after "
+              << convergedDeformer->GetIteration() << " iterations" << std::endl;
+    return 1;
+  }
+
+  // Save result
+
+  vtkNew<vtkXMLPolyDataWriter> writer;
+  writer->SetInputConnection(deformer->GetOutputPort());
+  writer->SetFileName("deform_vessel_tree.vtp");
+  writer->Write();
+
+  return 0;
+}
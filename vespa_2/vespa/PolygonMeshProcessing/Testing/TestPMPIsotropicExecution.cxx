@@ -1,6 +1,9 @@
 #include <iostream>
 
+#include <vtkDataArray.h>
+#include <vtkFieldData.h>
 #include <vtkNew.h>
+#include <vtkPolyData.h>
 #include <vtkTestUtilities.h>
 #include <vtkXMLPolyDataReader.h>
 #include <vtkXMLPolyDataWriter.h>
@@ -21,6 +24,7 @@ int TestPMPIsotropicExecution(int, char* argv[])
   vtkNew<vtkCGALIsotropicRemesher> rm;
   rm->SetInputConnection(reader->GetOutputPort());
   rm->SetNumberOfIterations(3);
+  rm->ReportTimingsOn();
 
   // Save result
 
@@ -29,5 +33,14 @@ int TestPMPIsotropicExecution(int, char* argv[])
   writer->SetFileName("isotropic_remesh.vtp");
   writer->Write();
 
+  // Check the stages: whole filter, conversions and remeshing at least
+
+  vtkDataArray* times = rm->GetOutput()->GetFieldData()->GetArray("vtkCGALStageTimes");
+  if (!times || times->GetNumberOfTuples() < 4)
+  {
+    std::cerr << "Missing stage timings." << std::endl;
+    return 1;
+  }
+
   return 0;
 }
@@ -1,7 +1,18 @@
 #include <iostream>
+#include <map>
+#include <string>
 
+#include "vtkCellArray.h"
+#include "vtkCellData.h"
+#include "vtkFieldData.h"
+#include "vtkIdTypeArray.h"
 #include "vtkNew.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkStringArray.h"
+#include "vtkTable.h"
 #include "vtkTestUtilities.h"
+#include "vtkUnsignedCharArray.h"
 #include "vtkXMLPolyDataReader.h"
 #include "vtkXMLPolyDataWriter.h"
 
@@ -27,5 +38,100 @@ int TestPMPMeshCheckerExecution(int, char* argv[])
   writer->SetFileName("checker.vtp");
   writer->Write();
 
+  // Two crossing triangles, reported on two threads
+  vtkNew<vtkPoints> points;
+  points->InsertNextPoint(0., 0., 0.);
+  points->InsertNextPoint(1., 0., 0.);
+  points->InsertNextPoint(0., 1., 0.);
+  points->InsertNextPoint(0.2, 0.2, -0.5);
+  points->InsertNextPoint(0.2, 0.2, 0.5);
+  points->InsertNextPoint(0.8, 0.1, 0.);
+  vtkNew<vtkCellArray> triangles;
+  const vtkIdType      first[3]  = { 0, 1, 2 };
+  const vtkIdType      second[3] = { 3, 4, 5 };
+  triangles->InsertNextCell(3, first);
+  triangles->InsertNextCell(3, second);
+  vtkNew<vtkPolyData> crossing;
+  crossing->SetPoints(points);
+  crossing->SetPolys(triangles);
+
+  vtkNew<vtkCGALMeshChecker> intersectChecker;
+  intersectChecker->SetInputData(crossing);
+  intersectChecker->CheckWatertightOff();
+  intersectChecker->SetNumberOfThreads(2);
+  std::cout << "EXPECTED WARNING|: Self intersection detected." << std::endl;
+  intersectChecker->Update();
+
+  vtkPolyData*    checked = intersectChecker->GetOutput();
+  vtkIdTypeArray* counts =
+    vtkIdTypeArray::SafeDownCast(checked->GetCellData()->GetArray("SelfIntersections"));
+  vtkIdTypeArray* pairs =
+    vtkIdTypeArray::SafeDownCast(checked->GetFieldData()->GetArray("SelfIntersectingPairs"));
+  if (!counts || !pairs || pairs->GetNumberOfTuples() != 1 || counts->GetValue(0) != 1 ||
+    counts->GetValue(1) != 1)
+  {
+    std::cerr << "The intersecting triangles are not reported." << std::endl;
+    return 1;
+  }
+
+  // Two separate triangles: two border cycles, no other defect
+  vtkTable*       report  = intersectChecker->GetReportOutput();
+  vtkStringArray* defects = vtkStringArray::SafeDownCast(report->GetColumnByName("Defect"));
+  vtkIdTypeArray* number  = vtkIdTypeArray::SafeDownCast(report->GetColumnByName("Count"));
+  if (!defects || !number)
+  {
+    std::cerr << "Missing defect report." << std::endl;
+    return 1;
+  }
+  const std::map<std::string, vtkIdType> expected = { { "BorderEdges", 6 }, { "BorderCycles", 2 },
+    { "NonManifoldEdges", 0 }, { "NonManifoldVertices", 0 }, { "DegenerateFaces", 0 },
+    { "DuplicateVertices", 0 }, { "ConnectedComponents", 2 }, { "SelfIntersectingPairs", 1 } };
+  for (vtkIdType row = 0; row < report->GetNumberOfRows(); row++)
+  {
+    auto it = expected.find(defects->GetValue(row));
+    if (it == expected.end() || it->second != number->GetValue(row))
+    {
+      std::cerr << "Wrong " << defects->GetValue(row) << " count: " << number->GetValue(row)
+                << std::endl;
+      return 1;
+    }
+  }
+  vtkIdTypeArray* componentIds =
+    vtkIdTypeArray::SafeDownCast(checked->GetCellData()->GetArray("ComponentId"));
+  if (report->GetNumberOfRows() != static_cast<vtkIdType>(expected.size()) || !componentIds ||
+    componentIds->GetValue(0) != 0 || componentIds->GetValue(1) != 1)
+  {
+    std::cerr << "Wrong defect report." << std::endl;
+    return 1;
+  }
+
+  // A triangle on a line whose Newell normal is not exactly null in floating point
+  vtkNew<vtkPoints> linePoints;
+  linePoints->InsertNextPoint(0., 0., 0.);
+  linePoints->InsertNextPoint(1., 0., 0.);
+  linePoints->InsertNextPoint(0., 1., 0.);
+  const double start = 0.1;
+  for (double step : { 0., 0.125, 0.25 })
+  {
+    linePoints->InsertNextPoint(start + step, start + step, start + step);
+  }
+  vtkNew<vtkPolyData> flat;
+  flat->SetPoints(linePoints);
+  flat->SetPolys(triangles);
+
+  vtkNew<vtkCGALMeshChecker> flatChecker;
+  flatChecker->SetInputData(flat);
+  flatChecker->CheckWatertightOff();
+  flatChecker->CheckIntersectOff();
+  flatChecker->Update();
+
+  vtkUnsignedCharArray* degenerate = vtkUnsignedCharArray::SafeDownCast(
+    flatChecker->GetOutput()->GetCellData()->GetArray("DegenerateFaces"));
+  if (!degenerate || degenerate->GetValue(0) != 0 || degenerate->GetValue(1) != 1)
+  {
+    std::cerr << "The triangle on a line is not reported as degenerate." << std::endl;
+    return 1;
+  }
+
   return 0;
 }
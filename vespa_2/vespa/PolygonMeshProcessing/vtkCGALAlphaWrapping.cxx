@@ -64,7 +64,8 @@ int vtkCGALAlphaWrapping::RequestData(
 
   try
   {
-    CGAL::alpha_wrap_3(cgalMesh->points, cgalMesh->faces, alpha, offset, cgalOutput->surface);
+    StageTimer stage(this, "alpha_wrap_3", cgalMesh->number_of_faces());
+    CGAL::alpha_wrap_3(cgalMesh->points, cgalMesh->faces(), alpha, offset, cgalOutput->surface);
   }
   catch (std::exception& e)
   {
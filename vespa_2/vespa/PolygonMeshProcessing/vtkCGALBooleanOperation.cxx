@@ -1,22 +1,672 @@
 #include "vtkCGALBooleanOperation.h"
 
 // VTK related includes
+#include "vtkCellArray.h"
+#include "vtkCellArrayIterator.h"
+#include "vtkCellData.h"
+#include "vtkCompositeDataIterator.h"
+#include "vtkDataSetAttributes.h"
+#include "vtkFieldData.h"
 #include "vtkInformationVector.h"
+#include "vtkMath.h"
+#include "vtkMultiBlockDataSet.h"
 #include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkSMPTools.h"
+#include "vtkSmartPointer.h"
+
+// VESPA related includes
+#include "vtkCGALPolyDataView.h"
+#include "vtkCGALSelfIntersections.h"
 
 // CGAL related includes
+#include <CGAL/Polygon_mesh_processing/connected_components.h>
 #include <CGAL/Polygon_mesh_processing/corefinement.h>
+#include <CGAL/Polygon_mesh_processing/orientation.h>
+#include <CGAL/Side_of_triangle_mesh.h>
+#include <CGAL/box_intersection_d.h>
+
+// STL related includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
 vtkStandardNewMacro(vtkCGALBooleanOperation);
 
 namespace pmp = CGAL::Polygon_mesh_processing;
 
+using Graph_Side = CGAL::Side_of_triangle_mesh<CGAL_Surface, CGAL_Kernel>;
+
+//------------------------------------------------------------------------------
+// Source converted and oriented to bound a volume, reused by the executions
+// as long as the source does not change
+struct vtkCGALBooleanOperation::SourceCache
+{
+  Vespa_surface Mesh;
+
+  // point location in Mesh, its AABB tree is built on the first query
+  std::unique_ptr<Graph_Side> Side;
+
+  // state of the source the cache was built for
+  vtkMTimeType  Time = 0;
+  std::uint64_t Hash = 0;
+};
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Keep track of the input cell each face comes from when the
+// corefinement splits the faces of the input mesh.
+struct OriginVisitor : public pmp::Corefinement::Default_visitor<CGAL_Surface>
+{
+  explicit OriginVisitor(const Vespa_surface* mesh)
+    : input(&mesh->surface)
+    , faceOrigin(mesh->face_origin)
+  {
+  }
+
+  void before_subface_creations(Graph_Faces splitFace, const CGAL_Surface& tm)
+  {
+    this->splitOrigin = &tm == this->input ? get(this->faceOrigin, splitFace) : -1;
+  }
+
+  void after_subface_created(Graph_Faces newFace, const CGAL_Surface& tm)
+  {
+    if (&tm == this->input)
+    {
+      put(this->faceOrigin, newFace, this->splitOrigin);
+    }
+  }
+
+  const CGAL_Surface* input;
+  Graph_Forig         faceOrigin;
+  vtkIdType           splitOrigin = -1;
+};
+
+using Graph_Edges = boost::graph_traits<CGAL_Surface>::edge_descriptor;
+
+//------------------------------------------------------------------------------
+// Hash of the points and polygons of the mesh
+std::uint64_t contentHash(vtkPolyData* mesh)
+{
+  std::uint64_t h   = 0;
+  const auto    mix = [&h](std::uint64_t value) {
+    // splitmix64 finalizer of the running hash
+    std::uint64_t x = h ^ (value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+    x               = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x               = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    h               = x ^ (x >> 31);
+  };
+
+  mix(static_cast<std::uint64_t>(mesh->GetNumberOfPoints()));
+  for (vtkIdType pid = 0; pid < mesh->GetNumberOfPoints(); pid++)
+  {
+    double p[3];
+    mesh->GetPoint(pid, p);
+    for (double coord : p)
+    {
+      std::uint64_t bits;
+      std::memcpy(&bits, &coord, sizeof(bits));
+      mix(bits);
+    }
+  }
+
+  mix(static_cast<std::uint64_t>(mesh->GetNumberOfPolys()));
+  auto polysIt = vtk::TakeSmartPointer(mesh->GetPolys()->NewIterator());
+  for (polysIt->GoToFirstCell(); !polysIt->IsDoneWithTraversal(); polysIt->GoToNextCell())
+  {
+    vtkIdList* poly = polysIt->GetCurrentCell();
+    mix(static_cast<std::uint64_t>(poly->GetNumberOfIds()));
+    for (vtkIdType i = 0; i < poly->GetNumberOfIds(); i++)
+    {
+      mix(static_cast<std::uint64_t>(poly->GetId(i)));
+    }
+  }
+  return h;
+}
+
+//------------------------------------------------------------------------------
+// Copy a surface with its origins. The property maps of the copy are
+// fetched again as the handles of from refer to its own storage.
+void copySurface(const Vespa_surface& from, Vespa_surface* to)
+{
+  to->surface       = from.surface;
+  to->coords        = get(CGAL::vertex_point, to->surface);
+  to->vertex_origin = to->surface.property_map<Graph_Verts, vtkIdType>("v:vespa_origin").first;
+  to->face_origin   = to->surface.property_map<Graph_Faces, vtkIdType>("f:vespa_origin").first;
+}
+
+//------------------------------------------------------------------------------
+// Centroid of a face, strictly inside it
+CGAL_Kernel::Point_3 faceCentroid(const CGAL_Surface& mesh, Graph_Faces face)
+{
+  double    c[3] = { 0., 0., 0. };
+  vtkIdType nb   = 0;
+  for (Graph_Verts v : vertices_around_face(halfedge(face, mesh), mesh))
+  {
+    const auto& p = mesh.point(v);
+    c[0] += p.x();
+    c[1] += p.y();
+    c[2] += p.z();
+    nb++;
+  }
+  return CGAL_Kernel::Point_3(c[0] / nb, c[1] / nb, c[2] / nb);
+}
+
+//------------------------------------------------------------------------------
+// Volume bounded by the polygons, positive when they are oriented outward
+double signedVolume(vtkPolyData* mesh)
+{
+  vtkPoints* points  = mesh->GetPoints();
+  double     volume  = 0.;
+  auto       polysIt = vtk::TakeSmartPointer(mesh->GetPolys()->NewIterator());
+  for (polysIt->GoToFirstCell(); !polysIt->IsDoneWithTraversal(); polysIt->GoToNextCell())
+  {
+    vtkIdList* poly = polysIt->GetCurrentCell();
+    double     p0[3], p1[3], p2[3], normal[3];
+    points->GetPoint(poly->GetId(0), p0);
+    for (vtkIdType i = 1; i + 1 < poly->GetNumberOfIds(); i++)
+    {
+      points->GetPoint(poly->GetId(i), p1);
+      points->GetPoint(poly->GetId(i + 1), p2);
+      vtkMath::Cross(p1, p2, normal);
+      volume += vtkMath::Dot(p0, normal) / 6.;
+    }
+  }
+  return volume;
+}
+
+//------------------------------------------------------------------------------
+// Side of the closed triangulated mesh the point lies on, from the parity of the
+// crossings of a segment leaving its bounds. Segments through an edge or a vertex
+// are cast again in another direction, ON_BOUNDARY is returned when all of them fail.
+CGAL::Bounded_side sideOfMesh(vtkPolyData* mesh, const CGAL_Kernel::Point_3& p)
+{
+  double bounds[6];
+  mesh->GetBounds(bounds);
+  if (p.x() < bounds[0] || p.x() > bounds[1] || p.y() < bounds[2] || p.y() > bounds[3] ||
+    p.z() < bounds[4] || p.z() > bounds[5])
+  {
+    return CGAL::ON_UNBOUNDED_SIDE;
+  }
+
+  // directions away from the axes, which meshes are often aligned with
+  const double directions[3][3] = { { 0.8123, 0.4567, 0.3627 }, { -0.3141, 0.8876, -0.3369 },
+    { 0.4213, -0.5347, 0.7326 } };
+  const double length = 2. * mesh->GetLength();
+
+  vtkPoints* points = mesh->GetPoints();
+  for (const auto& dir : directions)
+  {
+    const CGAL_Kernel::Point_3 q(
+      p.x() + length * dir[0], p.y() + length * dir[1], p.z() + length * dir[2]);
+
+    bool odd        = false;
+    bool degenerate = false;
+    auto polysIt    = vtk::TakeSmartPointer(mesh->GetPolys()->NewIterator());
+    for (polysIt->GoToFirstCell(); !polysIt->IsDoneWithTraversal() && !degenerate;
+         polysIt->GoToNextCell())
+    {
+      vtkIdList* triangle = polysIt->GetCurrentCell();
+      double     a[3], b[3], c[3];
+      points->GetPoint(triangle->GetId(0), a);
+      points->GetPoint(triangle->GetId(1), b);
+      points->GetPoint(triangle->GetId(2), c);
+      const CGAL_Kernel::Point_3 pa(a[0], a[1], a[2]);
+      const CGAL_Kernel::Point_3 pb(b[0], b[1], b[2]);
+      const CGAL_Kernel::Point_3 pc(c[0], c[1], c[2]);
+      if (CGAL::collinear(pa, pb, pc))
+      {
+        continue;
+      }
+
+      // the segment must cross the plane of the triangle
+      const CGAL::Orientation op = CGAL::orientation(pa, pb, pc, p);
+      const CGAL::Orientation oq = CGAL::orientation(pa, pb, pc, q);
+      if (op == CGAL::COPLANAR)
+      {
+        if (CGAL_Kernel::Triangle_3(pa, pb, pc).has_on(p))
+        {
+          return CGAL::ON_BOUNDARY;
+        }
+        degenerate = oq == CGAL::COPLANAR;
+        continue;
+      }
+      if (op == oq)
+      {
+        continue;
+      }
+      if (oq == CGAL::COPLANAR)
+      {
+        degenerate = true;
+        continue;
+      }
+
+      // then cross the triangle, on the same side of its three edges
+      const CGAL::Orientation s1       = CGAL::orientation(p, q, pa, pb);
+      const CGAL::Orientation s2       = CGAL::orientation(p, q, pb, pc);
+      const CGAL::Orientation s3       = CGAL::orientation(p, q, pc, pa);
+      const bool              positive = s1 == CGAL::POSITIVE || s2 == CGAL::POSITIVE ||
+        s3 == CGAL::POSITIVE;
+      const bool negative = s1 == CGAL::NEGATIVE || s2 == CGAL::NEGATIVE || s3 == CGAL::NEGATIVE;
+      if (positive && negative)
+      {
+        continue;
+      }
+      if (s1 == CGAL::COPLANAR || s2 == CGAL::COPLANAR || s3 == CGAL::COPLANAR)
+      {
+        degenerate = true;
+        continue;
+      }
+      odd = !odd;
+    }
+
+    if (!degenerate)
+    {
+      return odd ? CGAL::ON_BOUNDED_SIDE : CGAL::ON_UNBOUNDED_SIDE;
+    }
+  }
+  return CGAL::ON_BOUNDARY;
+}
+
+//------------------------------------------------------------------------------
+// Whether the mesh is a closed and manifold triangle mesh, oriented outward, so
+// that it bounds a volume whose inside sideOfMesh can tell
+bool isClosedOutwardTriangleMesh(vtkPolyData* mesh)
+{
+  if (mesh->GetNumberOfPolys() == 0 || mesh->GetNumberOfCells() != mesh->GetNumberOfPolys() ||
+    mesh->GetPolys()->IsHomogeneous() != 3)
+  {
+    return false;
+  }
+  Vespa_view view;
+  return view.build(mesh) == Vespa_view::VALID && view.number_of_border_halfedges() == 0 &&
+    ::signedVolume(mesh) > 0.;
+}
+
+//------------------------------------------------------------------------------
+// Bounds of a polygon of the mesh
+void polyBounds(vtkPoints* points, vtkIdList* poly, double bounds[6])
+{
+  bounds[0] = bounds[2] = bounds[4] = VTK_DOUBLE_MAX;
+  bounds[1] = bounds[3] = bounds[5] = VTK_DOUBLE_MIN;
+  for (vtkIdType i = 0; i < poly->GetNumberOfIds(); i++)
+  {
+    double p[3];
+    points->GetPoint(poly->GetId(i), p);
+    for (int k = 0; k < 3; k++)
+    {
+      bounds[2 * k]     = std::min(bounds[2 * k], p[k]);
+      bounds[2 * k + 1] = std::max(bounds[2 * k + 1], p[k]);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Split the polygons of the mesh between those whose bounds overlap the box
+// and the other ones. The mesh must only have polygons.
+void splitCells(vtkPolyData* mesh, const double box[6], std::vector<vtkIdType>& overlapping,
+  std::vector<vtkIdType>& others)
+{
+  vtkPoints* points  = mesh->GetPoints();
+  auto       polysIt = vtk::TakeSmartPointer(mesh->GetPolys()->NewIterator());
+  for (polysIt->GoToFirstCell(); !polysIt->IsDoneWithTraversal(); polysIt->GoToNextCell())
+  {
+    double cellBounds[6];
+    ::polyBounds(points, polysIt->GetCurrentCell(), cellBounds);
+
+    bool overlap = true;
+    for (int k = 0; k < 3 && overlap; k++)
+    {
+      overlap = cellBounds[2 * k] <= box[2 * k + 1] && box[2 * k] <= cellBounds[2 * k + 1];
+    }
+    (overlap ? overlapping : others).emplace_back(polysIt->GetCurrentCellId());
+  }
+}
+
+//------------------------------------------------------------------------------
+// The given polygons of the mesh, with the mesh point of each patch point.
+// The mesh must only have polygons.
+vtkSmartPointer<vtkPolyData> extractPatch(
+  vtkPolyData* mesh, const std::vector<vtkIdType>& cells, std::vector<vtkIdType>& patchToMesh)
+{
+  vtkPoints*             points = mesh->GetPoints();
+  std::vector<vtkIdType> meshToPatch(mesh->GetNumberOfPoints(), -1);
+  vtkNew<vtkPoints>      patchPoints;
+  patchPoints->SetDataType(points->GetDataType());
+  vtkNew<vtkCellArray> patchPolys;
+
+  vtkCellArray*     meshPolys = mesh->GetPolys();
+  vtkNew<vtkIdList> poly;
+  for (vtkIdType cid : cells)
+  {
+    meshPolys->GetCellAtId(cid, poly);
+    patchPolys->InsertNextCell(poly->GetNumberOfIds());
+    for (vtkIdType i = 0; i < poly->GetNumberOfIds(); i++)
+    {
+      vtkIdType& pid = meshToPatch[poly->GetId(i)];
+      if (pid < 0)
+      {
+        pid = patchPoints->InsertNextPoint(points->GetPoint(poly->GetId(i)));
+        patchToMesh.emplace_back(poly->GetId(i));
+      }
+      patchPolys->InsertCellPoint(pid);
+    }
+  }
+
+  auto patch = vtkSmartPointer<vtkPolyData>::New();
+  patch->SetPoints(patchPoints);
+  patch->SetPolys(patchPolys);
+  return patch;
+}
+
+//------------------------------------------------------------------------------
+// Corefine the patch of the input with the closed tool, then gather in result
+// the faces of both kept by the operation. The origins of the patch refer to
+// the input through patchToInput and patchCellToInput. side locates points in
+// the tool, the corefined tool is used when null. Return false when the
+// operation can not be decided locally, e.g. when a piece lies on the other
+// surface. Only reads the VTK input, whose bounds must be up to date.
+bool operatePatch(Vespa_surface* cgalPatch, const std::vector<vtkIdType>& patchToInput,
+  const std::vector<vtkIdType>& patchCellToInput, CGAL_Surface& tool, const Graph_Side* side,
+  vtkPolyData* input, int operation, Vespa_surface* cgalResult)
+{
+  CGAL_Surface& patch = cgalPatch->surface;
+
+  // Corefine the patch only, its intersection with the tool is constrained
+  auto patchCurve = patch.add_property_map<Graph_Edges, bool>("e:vespa_intersection", false).first;
+  auto toolCurve  = tool.add_property_map<Graph_Edges, bool>("e:vespa_intersection", false).first;
+  if (num_faces(patch) > 0)
+  {
+    ::OriginVisitor visitor(cgalPatch);
+    pmp::corefine(patch, tool,
+      pmp::parameters::visitor(visitor).edge_is_constrained_map(patchCurve),
+      pmp::parameters::edge_is_constrained_map(toolCurve));
+  }
+
+  // Classify the pieces delimited by the intersection
+  auto patchComponents =
+    patch.add_property_map<Graph_Faces, std::size_t>("f:vespa_component", 0).first;
+  auto toolComponents =
+    tool.add_property_map<Graph_Faces, std::size_t>("f:vespa_component", 0).first;
+  const std::size_t nbPatchComponents = pmp::connected_components(
+    patch, patchComponents, pmp::parameters::edge_is_constrained_map(patchCurve));
+  const std::size_t nbToolComponents = pmp::connected_components(
+    tool, toolComponents, pmp::parameters::edge_is_constrained_map(toolCurve));
+
+  // -1 while unclassified, then 1 when kept, 0 otherwise
+  std::vector<int> keepPatch(nbPatchComponents, -1);
+  std::vector<int> keepTool(nbToolComponents, -1);
+  const bool       intersection = operation == vtkCGALBooleanOperation::INTERSECTION;
+  const bool       difference   = operation == vtkCGALBooleanOperation::DIFFERENCE;
+
+  // the corefined tool bounds the same volume as the given one
+  std::unique_ptr<Graph_Side> corefinedSide;
+  if (!side)
+  {
+    corefinedSide = std::make_unique<Graph_Side>(tool);
+    side          = corefinedSide.get();
+  }
+  for (Graph_Faces face : faces(patch))
+  {
+    int& keep = keepPatch[get(patchComponents, face)];
+    if (keep < 0)
+    {
+      const CGAL::Bounded_side location = (*side)(::faceCentroid(patch, face));
+      if (location == CGAL::ON_BOUNDARY)
+      {
+        return false;
+      }
+      keep = (location == CGAL::ON_BOUNDED_SIDE) == intersection;
+    }
+  }
+  for (Graph_Faces face : faces(tool))
+  {
+    int& keep = keepTool[get(toolComponents, face)];
+    if (keep < 0)
+    {
+      const CGAL::Bounded_side location = ::sideOfMesh(input, ::faceCentroid(tool, face));
+      if (location == CGAL::ON_BOUNDARY)
+      {
+        return false;
+      }
+      keep = (location == CGAL::ON_BOUNDED_SIDE) == (operation != vtkCGALBooleanOperation::UNION);
+    }
+  }
+
+  // Merge the kept faces, the vertices of the intersection are shared
+  CGAL_Surface&            result = cgalResult->surface;
+  std::vector<Graph_Verts> patchToResult(num_vertices(patch));
+  std::map<CGAL_Kernel::Point_3, Graph_Verts> curveVertices;
+  for (Graph_Verts v : vertices(patch))
+  {
+    patchToResult[v]       = result.add_vertex(patch.point(v));
+    const vtkIdType origin = get(cgalPatch->vertex_origin, v);
+    put(cgalResult->vertex_origin, patchToResult[v], origin < 0 ? -1 : patchToInput[origin]);
+  }
+  for (Graph_Edges e : edges(patch))
+  {
+    if (get(patchCurve, e))
+    {
+      curveVertices[patch.point(source(e, patch))] = patchToResult[source(e, patch)];
+      curveVertices[patch.point(target(e, patch))] = patchToResult[target(e, patch)];
+    }
+  }
+
+  std::vector<Graph_Verts> polygon;
+  for (Graph_Faces face : faces(patch))
+  {
+    if (keepPatch[get(patchComponents, face)] == 1)
+    {
+      polygon.clear();
+      for (Graph_Verts v : vertices_around_face(halfedge(face, patch), patch))
+      {
+        polygon.emplace_back(patchToResult[v]);
+      }
+      const Graph_Faces added = result.add_face(polygon);
+      if (added == CGAL_Surface::null_face())
+      {
+        return false;
+      }
+      const vtkIdType origin = get(cgalPatch->face_origin, face);
+      put(cgalResult->face_origin, added, origin < 0 ? -1 : patchCellToInput[origin]);
+    }
+  }
+
+  std::vector<Graph_Verts> toolToResult(num_vertices(tool), CGAL_Surface::null_vertex());
+  for (Graph_Faces face : faces(tool))
+  {
+    if (keepTool[get(toolComponents, face)] != 1)
+    {
+      continue;
+    }
+    polygon.clear();
+    for (Graph_Verts v : vertices_around_face(halfedge(face, tool), tool))
+    {
+      Graph_Verts& added = toolToResult[v];
+      if (added == CGAL_Surface::null_vertex())
+      {
+        auto curveIt = curveVertices.find(tool.point(v));
+        added        = curveIt != curveVertices.end() ? curveIt->second
+                                                      : result.add_vertex(tool.point(v));
+      }
+      polygon.emplace_back(added);
+    }
+    if (difference)
+    {
+      std::reverse(polygon.begin(), polygon.end());
+    }
+    if (result.add_face(polygon) == CGAL_Surface::null_face())
+    {
+      return false;
+    }
+  }
+
+  // the patch vertices of the discarded faces
+  for (Graph_Verts v : vertices(result))
+  {
+    if (result.is_isolated(v))
+    {
+      result.remove_vertex(v);
+    }
+  }
+  result.collect_garbage();
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+// Input point of each vertex of the surface, in the order of toVTK
+std::vector<vtkIdType> vertexOrigins(const Vespa_surface& mesh)
+{
+  std::vector<vtkIdType> origins;
+  origins.reserve(num_vertices(mesh.surface));
+  for (Graph_Verts v : vertices(mesh.surface))
+  {
+    origins.emplace_back(get(mesh.vertex_origin, v));
+  }
+  return origins;
+}
+
+//------------------------------------------------------------------------------
+// The remainder cells of the mesh followed by the cells of the patches,
+// connected through the mesh points of their borders. The attributes common
+// to all of them are kept, as well as the field data of the first patch.
+void stitchPatches(vtkPolyData* mesh, const std::vector<vtkIdType>& remainder,
+  const std::vector<vtkSmartPointer<vtkPolyData>>& patches,
+  const std::vector<std::vector<vtkIdType>>& patchesToMesh, vtkPolyData* output)
+{
+  // dataset, -1 for the mesh, and point each output point is copied from
+  std::vector<std::pair<int, vtkIdType>> pointSources;
+  std::vector<vtkIdType>                 meshToOutput(mesh->GetNumberOfPoints(), -1);
+  vtkNew<vtkCellArray>                   cells;
+  vtkCellArray*                          meshPolys = mesh->GetPolys();
+  vtkNew<vtkIdList>                      poly;
+  for (vtkIdType cid : remainder)
+  {
+    meshPolys->GetCellAtId(cid, poly);
+    cells->InsertNextCell(poly->GetNumberOfIds());
+    for (vtkIdType i = 0; i < poly->GetNumberOfIds(); i++)
+    {
+      vtkIdType& pid = meshToOutput[poly->GetId(i)];
+      if (pid < 0)
+      {
+        pid = static_cast<vtkIdType>(pointSources.size());
+        pointSources.emplace_back(-1, poly->GetId(i));
+      }
+      cells->InsertCellPoint(pid);
+    }
+  }
+
+  for (std::size_t k = 0; k < patches.size(); k++)
+  {
+    vtkPolyData*           patch = patches[k];
+    std::vector<vtkIdType> patchToOutput(patch->GetNumberOfPoints());
+    for (vtkIdType pid = 0; pid < patch->GetNumberOfPoints(); pid++)
+    {
+      const vtkIdType origin = patchesToMesh[k][pid];
+      if (origin >= 0 && meshToOutput[origin] >= 0)
+      {
+        patchToOutput[pid] = meshToOutput[origin];
+        continue;
+      }
+      patchToOutput[pid] = static_cast<vtkIdType>(pointSources.size());
+      pointSources.emplace_back(static_cast<int>(k), pid);
+      if (origin >= 0)
+      {
+        meshToOutput[origin] = patchToOutput[pid];
+      }
+    }
+
+    auto patchIt = vtk::TakeSmartPointer(patch->GetPolys()->NewIterator());
+    for (patchIt->GoToFirstCell(); !patchIt->IsDoneWithTraversal(); patchIt->GoToNextCell())
+    {
+      vtkIdList* patchPoly = patchIt->GetCurrentCell();
+      cells->InsertNextCell(patchPoly->GetNumberOfIds());
+      for (vtkIdType i = 0; i < patchPoly->GetNumberOfIds(); i++)
+      {
+        cells->InsertCellPoint(patchToOutput[patchPoly->GetId(i)]);
+      }
+    }
+  }
+
+  // points and attributes, the mesh comes first in the field lists
+  const vtkIdType   nbPoints = static_cast<vtkIdType>(pointSources.size());
+  vtkNew<vtkPoints> points;
+  points->SetDataType(mesh->GetPoints()->GetDataType());
+  points->SetNumberOfPoints(nbPoints);
+
+  const int                       nbLists = static_cast<int>(patches.size()) + 1;
+  vtkDataSetAttributes::FieldList pointFields(nbLists);
+  vtkDataSetAttributes::FieldList cellFields(nbLists);
+  pointFields.InitializeFieldList(mesh->GetPointData());
+  cellFields.InitializeFieldList(mesh->GetCellData());
+  vtkIdType nbCells = static_cast<vtkIdType>(remainder.size());
+  for (const auto& patch : patches)
+  {
+    pointFields.IntersectFieldList(patch->GetPointData());
+    cellFields.IntersectFieldList(patch->GetCellData());
+    nbCells += patch->GetNumberOfCells();
+  }
+
+  vtkPointData* outPD = output->GetPointData();
+  outPD->CopyAllocate(pointFields, nbPoints);
+  for (vtkIdType pid = 0; pid < nbPoints; pid++)
+  {
+    const int       k    = pointSources[pid].first;
+    const vtkIdType from = pointSources[pid].second;
+    vtkPolyData*    data = k < 0 ? mesh : patches[k].Get();
+    points->SetPoint(pid, data->GetPoint(from));
+    outPD->CopyData(pointFields, data->GetPointData(), k + 1, from, pid);
+  }
+
+  vtkCellData* outCD = output->GetCellData();
+  outCD->CopyAllocate(cellFields, nbCells);
+  vtkIdType outCid = 0;
+  for (vtkIdType cid : remainder)
+  {
+    outCD->CopyData(cellFields, mesh->GetCellData(), 0, cid, outCid++);
+  }
+  for (std::size_t k = 0; k < patches.size(); k++)
+  {
+    for (vtkIdType cid = 0; cid < patches[k]->GetNumberOfCells(); cid++)
+    {
+      outCD->CopyData(
+        cellFields, patches[k]->GetCellData(), static_cast<int>(k) + 1, cid, outCid++);
+    }
+  }
+
+  output->SetPoints(points);
+  output->SetPolys(cells);
+  if (!patches.empty())
+  {
+    output->GetFieldData()->ShallowCopy(patches[0]->GetFieldData());
+  }
+}
+}
+
 //------------------------------------------------------------------------------
 vtkCGALBooleanOperation::vtkCGALBooleanOperation()
 {
   this->SetNumberOfInputPorts(2);
 }
 
+//------------------------------------------------------------------------------
+vtkCGALBooleanOperation::~vtkCGALBooleanOperation() = default;
+
+//------------------------------------------------------------------------------
+void vtkCGALBooleanOperation::ReleaseSourceCache()
+{
+  this->CachedSource.reset();
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALBooleanOperation::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -39,28 +689,513 @@ void vtkCGALBooleanOperation::PrintSelf(ostream& os, vtkIndent indent)
          << "Unknown" << std::endl;
       break;
   }
+  os << indent << "LocalCorefinement: " << this->LocalCorefinement << std::endl;
 
   this->Superclass::PrintSelf(os, indent);
 }
 
+//------------------------------------------------------------------------------
+int vtkCGALBooleanOperation::FillInputPortInformation(int port, vtkInformation* info)
+{
+  info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPolyData");
+  if (port == 1)
+  {
+    info->Append(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkMultiBlockDataSet");
+  }
+  return 1;
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALBooleanOperation::SetSourceConnection(vtkAlgorithmOutput* algOutput)
 {
   this->SetInputConnection(1, algOutput);
 }
 
+//------------------------------------------------------------------------------
+vtkCGALBooleanOperation::SourceCache* vtkCGALBooleanOperation::UpdateSourceCache(
+  vtkPolyData* sourceData)
+{
+  SourceCache* cache = this->CachedSource.get();
+  if (cache && cache->Time == sourceData->GetMTime())
+  {
+    return cache;
+  }
+
+  // a source modified or replaced with the same content is still reused
+  const std::uint64_t hash = ::contentHash(sourceData);
+  if (cache && cache->Hash == hash)
+  {
+    cache->Time = sourceData->GetMTime();
+    return cache;
+  }
+
+  this->CachedSource.reset();
+  auto newCache = std::make_unique<SourceCache>();
+  this->toCGAL(sourceData, &newCache->Mesh);
+  {
+    StageTimer stage(this, "orient source", num_faces(newCache->Mesh.surface));
+    if (!pmp::does_bound_a_volume(newCache->Mesh.surface))
+    {
+      pmp::orient_to_bound_a_volume(newCache->Mesh.surface);
+    }
+  }
+  newCache->Side = std::make_unique<Graph_Side>(newCache->Mesh.surface);
+  newCache->Time = sourceData->GetMTime();
+  newCache->Hash = hash;
+
+  this->CachedSource = std::move(newCache);
+  return this->CachedSource.get();
+}
+
+//------------------------------------------------------------------------------
+bool vtkCGALBooleanOperation::ReduceOperation(
+  vtkPolyData* inputData, const std::vector<vtkPolyData*>& sources, vtkPolyData* output)
+{
+  // Create the surface meshes for CGAL
+  // ----------------------------------
+
+  // The input comes first and stays the left operand of its pairs,
+  // only its elements are known in the output.
+  std::vector<std::unique_ptr<Vespa_surface>> meshes;
+  meshes.emplace_back(std::make_unique<Vespa_surface>());
+  this->toCGAL(inputData, meshes.back().get());
+  for (vtkPolyData* sourceData : sources)
+  {
+    meshes.emplace_back(std::make_unique<Vespa_surface>());
+    Vespa_surface* cgalSource = meshes.back().get();
+    this->toCGAL(sourceData, cgalSource);
+    for (Graph_Verts v : vertices(cgalSource->surface))
+    {
+      put(cgalSource->vertex_origin, v, -1);
+    }
+    for (Graph_Faces f : faces(cgalSource->surface))
+    {
+      put(cgalSource->face_origin, f, -1);
+    }
+  }
+  const vtkIdType nbMeshes = static_cast<vtkIdType>(meshes.size());
+
+  // CGAL Processing
+  // ---------------
+
+  // Errors are gathered here as the workers can not report them
+  std::vector<std::string> errors(meshes.size());
+  {
+    StageTimer stage(this, "orient to bound a volume", nbMeshes);
+    vtkSMPTools::For(0, nbMeshes, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        try
+        {
+          if (!pmp::does_bound_a_volume(meshes[i]->surface))
+          {
+            pmp::orient_to_bound_a_volume(meshes[i]->surface);
+          }
+        }
+        catch (std::exception& e)
+        {
+          errors[i] = e.what();
+        }
+      }
+    });
+  }
+
+  // Balanced reduction tree: the meshes are combined two by two, the
+  // pairs of a level being independent. Each result is computed in
+  // place in the left mesh of its pair. For a difference, the sources
+  // are united first then subtracted from the input.
+  const bool      difference = this->OperationType == vtkCGALBooleanOperation::DIFFERENCE;
+  const vtkIdType first      = difference ? 1 : 0;
+  StageTimer      stage(this, "corefinement tree", nbMeshes);
+  for (vtkIdType step = 1; first + step < nbMeshes; step *= 2)
+  {
+    const vtkIdType nbPairs = (nbMeshes - first - step + 2 * step - 1) / (2 * step);
+    vtkSMPTools::For(0, nbPairs, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType pair = begin; pair < end; pair++)
+      {
+        const vtkIdType left  = first + 2 * step * pair;
+        const vtkIdType right = left + step;
+        if (!errors[left].empty() || !errors[right].empty())
+        {
+          errors[left] = errors[left].empty() ? errors[right] : errors[left];
+          continue;
+        }
+
+        CGAL_Surface&   leftMesh  = meshes[left]->surface;
+        CGAL_Surface&   rightMesh = meshes[right]->surface;
+        ::OriginVisitor visitor(meshes[left].get());
+        try
+        {
+          const bool res = this->OperationType != vtkCGALBooleanOperation::INTERSECTION
+            ? pmp::corefine_and_compute_union(leftMesh, rightMesh, leftMesh,
+                pmp::parameters::visitor(visitor), pmp::parameters::all_default())
+            : pmp::corefine_and_compute_intersection(leftMesh, rightMesh, leftMesh,
+                pmp::parameters::visitor(visitor), pmp::parameters::all_default());
+          if (!res)
+          {
+            errors[left] = "Boolean operation failed, check that the meshes bound volumes "
+                           "and do not self intersect.";
+          }
+        }
+        catch (std::exception& e)
+        {
+          errors[left] = std::string("CGAL Exception: ") + e.what();
+        }
+        meshes[right].reset();
+      }
+    });
+  }
+
+  if (difference && nbMeshes > 1 && errors[0].empty() && errors[1].empty())
+  {
+    ::OriginVisitor visitor(meshes[0].get());
+    try
+    {
+      if (!pmp::corefine_and_compute_difference(meshes[0]->surface, meshes[1]->surface,
+            meshes[0]->surface, pmp::parameters::visitor(visitor),
+            pmp::parameters::all_default()))
+      {
+        errors[0] = "Boolean operation failed, check that the meshes bound volumes "
+                    "and do not self intersect.";
+      }
+    }
+    catch (std::exception& e)
+    {
+      errors[0] = std::string("CGAL Exception: ") + e.what();
+    }
+  }
+
+  for (const std::string& error : errors)
+  {
+    if (!error.empty())
+    {
+      vtkErrorMacro(<< error);
+      return false;
+    }
+  }
+
+  // VTK Output
+  // ----------
+
+  this->toVTK(meshes[0].get(), output);
+  this->interpolateAttributes(inputData, meshes[0].get(), output);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkCGALBooleanOperation::LocalOperation(
+  vtkPolyData* inputData, vtkPolyData* sourceData, vtkPolyData* output)
+{
+  // The remainder is kept as is and the pieces are located by ray parity,
+  // which requires a closed input oriented outward
+  if (!::isClosedOutwardTriangleMesh(inputData))
+  {
+    return false;
+  }
+
+  // Split the input between the patch around the source and the remainder
+  // ----------------------------------------------------------------------
+
+  std::vector<vtkIdType>       patchCells, remainder, patchToInput;
+  vtkSmartPointer<vtkPolyData> patchData;
+  {
+    StageTimer stage(this, "extract patch", inputData->GetNumberOfCells());
+    double     box[6];
+    sourceData->GetBounds(box);
+    ::splitCells(inputData, box, patchCells, remainder);
+    patchData = ::extractPatch(inputData, patchCells, patchToInput);
+  }
+
+  std::unique_ptr<Vespa_surface> cgalPatch = std::make_unique<Vespa_surface>();
+  this->toCGAL(patchData, cgalPatch.get());
+  // the cached source is left untouched for the next executions
+  SourceCache*                   cache      = this->UpdateSourceCache(sourceData);
+  std::unique_ptr<Vespa_surface> cgalSource = std::make_unique<Vespa_surface>();
+  ::copySurface(cache->Mesh, cgalSource.get());
+
+  // CGAL Processing
+  // ---------------
+
+  Vespa_surface cgalResult;
+  {
+    StageTimer stage(this, "local corefinement",
+      num_faces(cgalPatch->surface) + num_faces(cgalSource->surface));
+    if (!::operatePatch(cgalPatch.get(), patchToInput, patchCells, cgalSource->surface,
+          cache->Side.get(), inputData, this->OperationType, &cgalResult))
+    {
+      return false;
+    }
+  }
+
+  // VTK Output
+  // ----------
+
+  auto patchResult = vtkSmartPointer<vtkPolyData>::New();
+  this->toVTK(&cgalResult, patchResult);
+  this->interpolateAttributes(inputData, &cgalResult, patchResult);
+
+  if (this->OperationType == vtkCGALBooleanOperation::INTERSECTION)
+  {
+    // the remainder lies outside of the source
+    remainder.clear();
+  }
+  ::stitchPatches(inputData, remainder, { patchResult }, { ::vertexOrigins(cgalResult) }, output);
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+bool vtkCGALBooleanOperation::MultiDifference(
+  vtkPolyData* inputData, const std::vector<vtkPolyData*>& tools, vtkPolyData* output)
+{
+  // The remainder is kept as is and the pieces are located by ray parity,
+  // which requires a closed input oriented outward
+  if (tools.empty() || !::isClosedOutwardTriangleMesh(inputData))
+  {
+    return false;
+  }
+
+  // Localize the tools
+  // ------------------
+
+  // The boxes of the input cells are intersected with the ones of all the
+  // tools in a single sweep. Tools sharing input cells or overlapping each
+  // other are gathered in clusters, which are then independent.
+  const vtkIdType        nbTools = static_cast<vtkIdType>(tools.size());
+  const vtkIdType        nbCells = inputData->GetNumberOfCells();
+  std::vector<vtkIdType> cluster(nbTools);
+  std::iota(cluster.begin(), cluster.end(), 0);
+  const auto root = [&cluster](vtkIdType tool) {
+    while (cluster[tool] != tool)
+    {
+      tool = cluster[tool] = cluster[cluster[tool]];
+    }
+    return tool;
+  };
+
+  std::vector<vtkIdType> cellTool(nbCells, -1);
+  {
+    StageTimer stage(this, "localize tools", nbCells + nbTools);
+
+    using Box = CGAL::Box_intersection_d::Box_with_info_d<double, 3, vtkIdType>;
+    std::vector<Box> cellBoxes;
+    cellBoxes.reserve(nbCells);
+    vtkPoints* points  = inputData->GetPoints();
+    auto       polysIt = vtk::TakeSmartPointer(inputData->GetPolys()->NewIterator());
+    for (polysIt->GoToFirstCell(); !polysIt->IsDoneWithTraversal(); polysIt->GoToNextCell())
+    {
+      double b[6];
+      ::polyBounds(points, polysIt->GetCurrentCell(), b);
+      cellBoxes.emplace_back(
+        CGAL::Bbox_3(b[0], b[2], b[4], b[1], b[3], b[5]), polysIt->GetCurrentCellId());
+    }
+    std::vector<Box> toolBoxes;
+    toolBoxes.reserve(nbTools);
+    for (vtkIdType t = 0; t < nbTools; t++)
+    {
+      const double* b = tools[t]->GetBounds();
+      toolBoxes.emplace_back(CGAL::Bbox_3(b[0], b[2], b[4], b[1], b[3], b[5]), t);
+    }
+
+    CGAL::box_intersection_d(cellBoxes.begin(), cellBoxes.end(), toolBoxes.begin(),
+      toolBoxes.end(), [&](const Box& cell, const Box& tool) {
+        vtkIdType& first = cellTool[cell.info()];
+        if (first < 0)
+        {
+          first = tool.info();
+        }
+        else
+        {
+          cluster[root(tool.info())] = root(first);
+        }
+      });
+    CGAL::box_self_intersection_d(toolBoxes.begin(), toolBoxes.end(),
+      [&](const Box& a, const Box& b) { cluster[root(a.info())] = root(b.info()); });
+  }
+
+  // tools and input cells of each cluster, the other cells are the remainder
+  std::vector<vtkIdType>              clusterIndex(nbTools, -1);
+  std::vector<std::vector<vtkIdType>> clusterTools, clusterCells;
+  for (vtkIdType t = 0; t < nbTools; t++)
+  {
+    vtkIdType& index = clusterIndex[root(t)];
+    if (index < 0)
+    {
+      index = static_cast<vtkIdType>(clusterTools.size());
+      clusterTools.emplace_back();
+      clusterCells.emplace_back();
+    }
+    clusterTools[index].emplace_back(t);
+  }
+  std::vector<vtkIdType> remainder;
+  for (vtkIdType cid = 0; cid < nbCells; cid++)
+  {
+    (cellTool[cid] < 0 ? remainder : clusterCells[clusterIndex[root(cellTool[cid])]])
+      .emplace_back(cid);
+  }
+  const vtkIdType nbClusters = static_cast<vtkIdType>(clusterTools.size());
+
+  // Create the surface meshes for CGAL
+  // ----------------------------------
+
+  std::vector<std::unique_ptr<Vespa_surface>> cgalPatches, cgalTools, cgalResults;
+  std::vector<std::vector<vtkIdType>>         patchesToInput(nbClusters);
+  for (vtkIdType c = 0; c < nbClusters; c++)
+  {
+    cgalPatches.emplace_back(std::make_unique<Vespa_surface>());
+    this->toCGAL(::extractPatch(inputData, clusterCells[c], patchesToInput[c]),
+      cgalPatches.back().get());
+    cgalResults.emplace_back(std::make_unique<Vespa_surface>());
+  }
+  for (vtkPolyData* tool : tools)
+  {
+    cgalTools.emplace_back(std::make_unique<Vespa_surface>());
+    this->toCGAL(tool, cgalTools.back().get());
+  }
+
+  // CGAL Processing
+  // ---------------
+
+  // The clusters are processed concurrently. The tools of a cluster are
+  // united in its first one, which is then subtracted from the patch.
+  // The input is only read, its bounds are computed beforehand.
+  inputData->GetBounds();
+  std::vector<std::string> errors(nbClusters);
+  std::vector<char>        decided(nbClusters, 0);
+  {
+    StageTimer stage(this, "local corefinements", nbClusters);
+    vtkSMPTools::For(0, nbClusters, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType c = begin; c < end; c++)
+      {
+        try
+        {
+          CGAL_Surface& tool = cgalTools[clusterTools[c][0]]->surface;
+          bool          res  = true;
+          for (std::size_t i = 0; i < clusterTools[c].size() && res; i++)
+          {
+            CGAL_Surface& member = cgalTools[clusterTools[c][i]]->surface;
+            if (!pmp::does_bound_a_volume(member))
+            {
+              pmp::orient_to_bound_a_volume(member);
+            }
+            res = i == 0 || pmp::corefine_and_compute_union(tool, member, tool);
+          }
+          decided[c] = res &&
+            ::operatePatch(cgalPatches[c].get(), patchesToInput[c], clusterCells[c], tool,
+              nullptr, inputData, vtkCGALBooleanOperation::DIFFERENCE, cgalResults[c].get());
+        }
+        catch (std::exception& e)
+        {
+          errors[c] = e.what();
+        }
+      }
+    });
+  }
+
+  for (vtkIdType c = 0; c < nbClusters; c++)
+  {
+    if (!errors[c].empty())
+    {
+      throw std::runtime_error(errors[c]);
+    }
+    if (!decided[c])
+    {
+      return false;
+    }
+  }
+
+  // VTK Output
+  // ----------
+
+  std::vector<vtkSmartPointer<vtkPolyData>> patchResults;
+  std::vector<std::vector<vtkIdType>>       resultsToInput;
+  for (vtkIdType c = 0; c < nbClusters; c++)
+  {
+    patchResults.emplace_back(vtkSmartPointer<vtkPolyData>::New());
+    this->toVTK(cgalResults[c].get(), patchResults.back());
+    this->interpolateAttributes(inputData, cgalResults[c].get(), patchResults.back());
+    resultsToInput.emplace_back(::vertexOrigins(*cgalResults[c]));
+  }
+  ::stitchPatches(inputData, remainder, patchResults, resultsToInput, output);
+
+  return true;
+}
+
 //------------------------------------------------------------------------------
 int vtkCGALBooleanOperation::RequestData(
   vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
   // Get the input and source data object
-  vtkPolyData* inputData  = vtkPolyData::GetData(inputVector[0]);
-  vtkPolyData* sourceData = vtkPolyData::GetData(inputVector[1]);
-  vtkPolyData* output     = vtkPolyData::GetData(outputVector);
+  vtkPolyData*          inputData   = vtkPolyData::GetData(inputVector[0]);
+  vtkPolyData*          sourceData  = vtkPolyData::GetData(inputVector[1]);
+  vtkMultiBlockDataSet* sourceBlock = vtkMultiBlockDataSet::GetData(inputVector[1]);
+  vtkPolyData*          output      = vtkPolyData::GetData(outputVector);
 
-  if (!inputData || !sourceData)
+  if (!inputData || (!sourceData && !sourceBlock))
   {
     vtkErrorMacro("Missing input or source.");
+    return 0;
+  }
+
+  // Combine all the blocks of a composite source at once
+  // -----------------------------------------------------
+
+  if (sourceBlock)
+  {
+    std::vector<vtkPolyData*>                 sources;
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(sourceBlock->NewIterator());
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+    {
+      sources.emplace_back(vtkPolyData::SafeDownCast(iter->GetCurrentDataObject()));
+      if (!sources.back())
+      {
+        vtkErrorMacro("The blocks of the source must be polydata.");
+        return 0;
+      }
+    }
+
+    if (this->OperationType == vtkCGALBooleanOperation::DIFFERENCE && this->LocalCorefinement)
+    {
+      try
+      {
+        if (this->MultiDifference(inputData, sources, output))
+        {
+          return 1;
+        }
+      }
+      catch (std::exception& e)
+      {
+        vtkErrorMacro("CGAL Exception: " << e.what());
+        return 0;
+      }
+      vtkDebugMacro("Local corefinement not applicable, corefining the whole meshes.");
+      output->Initialize();
+    }
+
+    return this->ReduceOperation(inputData, sources, output) ? 1 : 0;
+  }
+
+  // Corefine the input around the source only when possible
+  // --------------------------------------------------------
+
+  if (this->LocalCorefinement)
+  {
+    try
+    {
+      if (this->LocalOperation(inputData, sourceData, output))
+      {
+        return 1;
+      }
+    }
+    catch (std::exception& e)
+    {
+      vtkErrorMacro("CGAL Exception: " << e.what());
+      return 0;
+    }
+    vtkDebugMacro("Local corefinement not applicable, corefining the whole meshes.");
+    output->Initialize();
   }
 
   // Create the surface meshes for CGAL
@@ -69,41 +1204,45 @@ int vtkCGALBooleanOperation::RequestData(
   std::unique_ptr<Vespa_surface> cgalInputMesh = std::make_unique<Vespa_surface>();
   this->toCGAL(inputData, cgalInputMesh.get());
   std::unique_ptr<Vespa_surface> cgalSourceMesh = std::make_unique<Vespa_surface>();
-  this->toCGAL(sourceData, cgalSourceMesh.get());
-
-  std::unique_ptr<Vespa_surface> cgalOutMesh = std::make_unique<Vespa_surface>();
 
   // CGAL Processing
   // ---------------
 
+  // The result is computed in place in the input mesh so that
+  // the origin of its vertices and faces is kept.
+  ::OriginVisitor visitor(cgalInputMesh.get());
+  CGAL_Surface&   outMesh = cgalInputMesh->surface;
+
   bool res = true;
   try
   {
-    // Preprocess
-    if (!CGAL::Polygon_mesh_processing::does_bound_a_volume(cgalInputMesh->surface))
+    // Preprocess, the source is only converted and oriented when it changes
+    ::copySurface(this->UpdateSourceCache(sourceData)->Mesh, cgalSourceMesh.get());
     {
-      pmp::orient_to_bound_a_volume(cgalInputMesh->surface);
-    }
-    if (!CGAL::Polygon_mesh_processing::does_bound_a_volume(cgalSourceMesh->surface))
-    {
-      pmp::orient_to_bound_a_volume(cgalSourceMesh->surface);
+      StageTimer stage(this, "orient to bound a volume", num_faces(cgalInputMesh->surface));
+      if (!CGAL::Polygon_mesh_processing::does_bound_a_volume(cgalInputMesh->surface))
+      {
+        pmp::orient_to_bound_a_volume(cgalInputMesh->surface);
+      }
     }
 
     // Main process
+    StageTimer stage(
+      this, "corefinement", num_faces(cgalInputMesh->surface) + num_faces(cgalSourceMesh->surface));
     switch (this->OperationType)
     {
       case vtkCGALBooleanOperation::DIFFERENCE:
         res = pmp::corefine_and_compute_difference(cgalInputMesh->surface, cgalSourceMesh->surface,
-          cgalOutMesh->surface, pmp::parameters::all_default(), pmp::parameters::all_default());
+          outMesh, pmp::parameters::visitor(visitor), pmp::parameters::all_default());
         break;
       case vtkCGALBooleanOperation::INTERSECTION:
-        res =
-          pmp::corefine_and_compute_intersection(cgalInputMesh->surface, cgalSourceMesh->surface,
-            cgalOutMesh->surface, pmp::parameters::all_default(), pmp::parameters::all_default());
+        res = pmp::corefine_and_compute_intersection(cgalInputMesh->surface,
+          cgalSourceMesh->surface, outMesh, pmp::parameters::visitor(visitor),
+          pmp::parameters::all_default());
         break;
       case vtkCGALBooleanOperation::UNION:
         res = pmp::corefine_and_compute_union(cgalInputMesh->surface, cgalSourceMesh->surface,
-          cgalOutMesh->surface, pmp::parameters::all_default(), pmp::parameters::all_default());
+          outMesh, pmp::parameters::visitor(visitor), pmp::parameters::all_default());
         break;
       default:
         vtkErrorMacro("Unknown boolean operation!");
@@ -122,14 +1261,25 @@ int vtkCGALBooleanOperation::RequestData(
     // TODO: use the mesh checker instead here.
 
     // help user know the issue with their data.
-    // Most of these checks are done after the processing for performance reasons
+    // Most of these checks are done after the processing for performance reasons.
+    // The corefinement modified the CGAL meshes, so check the VTK inputs
+    // in place when possible.
     std::cerr << "Boolean operation failed. Checking precondition:" << std::endl;
-    bool se1 = CGAL::Polygon_mesh_processing::does_self_intersect(cgalInputMesh->surface);
-    bool se2 = CGAL::Polygon_mesh_processing::does_self_intersect(cgalSourceMesh->surface);
+    Vespa_view inputView;
+    Vespa_view sourceView;
+    bool       inputViewed  = this->toCGAL(inputData, &inputView);
+    bool       sourceViewed = this->toCGAL(sourceData, &sourceView);
+
+    bool se1 = inputViewed ? vtkCGALDoesSelfIntersect(this, inputView)
+                           : vtkCGALDoesSelfIntersect(this, cgalInputMesh->surface);
+    bool se2 = sourceViewed ? vtkCGALDoesSelfIntersect(this, sourceView)
+                            : vtkCGALDoesSelfIntersect(this, cgalSourceMesh->surface);
     std::cerr << "Input self intersect: " << se1 << std::endl;
     std::cerr << "Source self intersect: " << se2 << std::endl;
-    bool bv1 = CGAL::Polygon_mesh_processing::does_bound_a_volume(cgalInputMesh->surface);
-    bool bv2 = CGAL::Polygon_mesh_processing::does_bound_a_volume(cgalSourceMesh->surface);
+    bool bv1 = inputViewed ? pmp::does_bound_a_volume(inputView)
+                           : pmp::does_bound_a_volume(cgalInputMesh->surface);
+    bool bv2 = sourceViewed ? pmp::does_bound_a_volume(sourceView)
+                            : pmp::does_bound_a_volume(cgalSourceMesh->surface);
     std::cerr << "Input bounds a volume: " << bv1 << std::endl;
     std::cerr << "Source bounds a volume: " << bv2 << std::endl;
 
@@ -139,8 +1289,8 @@ int vtkCGALBooleanOperation::RequestData(
   // VTK Output
   // ----------
 
-  this->toVTK(cgalOutMesh.get(), output);
-  this->interpolateAttributes(inputData, output);
+  this->toVTK(cgalInputMesh.get(), output);
+  this->interpolateAttributes(inputData, cgalInputMesh.get(), output);
 
   return 1;
 }
@@ -6,6 +6,28 @@
  * between two closed, triangulated polygonal meshes.
  * These operations include union, intersection, and difference.
  * The resulting mesh is closed.
+ *
+ * By default, only the input faces overlapping the bounding box of the source
+ * are corefined, the other ones are copied back from the input as is. Inputs
+ * with disjoint bounding boxes are thus resolved without any intersection
+ * computation. A source nested in the input is still corefined with the input
+ * faces overlapping its bounding box.
+ *
+ * The source may also be a vtkMultiBlockDataSet of polydata for a union or an
+ * intersection with all of its blocks. The meshes are then combined two by two
+ * in a balanced tree whose independent pairs are processed concurrently, the
+ * intermediate results staying in CGAL form. For a difference, all the blocks
+ * are subtracted from the input in one pass: they are located among the input
+ * faces in a single box intersection sweep, then the clusters of overlapping
+ * blocks are subtracted from their own input patch concurrently.
+ *
+ * The source converted to CGAL, oriented and located through an AABB tree is
+ * kept between executions, so that only the input is processed when the same
+ * source is applied to several inputs. It is rebuilt when the source changes,
+ * as told by its MTime and then a hash of its points and polygons.
+ *
+ * When the operation fails, the meshes are checked for self intersections to
+ * report the cause, on NumberOfThreads threads when VESPA is built with TBB.
  */
 
 #ifndef vtkCGALBooleanOperation_h
@@ -15,6 +37,9 @@
 
 #include "vtkCGALPMPModule.h" // For export macro
 
+#include <memory> // For std::unique_ptr
+#include <vector> // For ReduceOperation
+
 class VTKCGALPMP_EXPORT vtkCGALBooleanOperation : public vtkCGALPolyDataAlgorithm
 {
 public:
@@ -43,18 +68,72 @@ public:
     OperationType, int, vtkCGALBooleanOperation::DIFFERENCE, vtkCGALBooleanOperation::UNION);
   ///@}
 
+  ///@{
   /**
-   * Set input connection for the second vtkPolyData.
+   * Get/set whether only the input faces around the source are corefined.
+   * This requires a closed and manifold triangulated input oriented outward,
+   * the whole meshes are corefined otherwise or when the operation can not be
+   * decided locally.
+   * Default is true.
+   **/
+  vtkGetMacro(LocalCorefinement, bool);
+  vtkSetMacro(LocalCorefinement, bool);
+  vtkBooleanMacro(LocalCorefinement, bool);
+  ///@}
+
+  /**
+   * Set input connection for the second vtkPolyData,
+   * or a vtkMultiBlockDataSet of them.
    **/
   void SetSourceConnection(vtkAlgorithmOutput* algOutput);
 
+  /**
+   * Release the source kept between executions.
+   * The next execution will convert it again.
+   **/
+  void ReleaseSourceCache();
+
 protected:
   vtkCGALBooleanOperation();
-  ~vtkCGALBooleanOperation() override = default;
+  ~vtkCGALBooleanOperation() override;
 
+  int FillInputPortInformation(int port, vtkInformation* info) override;
   int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
 
-  int OperationType = vtkCGALBooleanOperation::DIFFERENCE;
+  /**
+   * Compute the operation by corefining the input faces overlapping the
+   * bounding box of the source only, and copying the remaining ones.
+   * Return false, output left untouched, if it can not be decided this way.
+   **/
+  bool LocalOperation(vtkPolyData* input, vtkPolyData* source, vtkPolyData* output);
+
+  /**
+   * Compute the union or the intersection of the input with all the sources,
+   * through a balanced tree of pairwise corefinements. For a difference, the
+   * union of the sources computed this way is subtracted from the input.
+   **/
+  bool ReduceOperation(
+    vtkPolyData* input, const std::vector<vtkPolyData*>& sources, vtkPolyData* output);
+
+  /**
+   * Subtract all the tools from the input, each cluster of overlapping tools
+   * being subtracted from the input faces around it only.
+   * Return false, output left untouched, if it can not be decided this way.
+   **/
+  bool MultiDifference(
+    vtkPolyData* input, const std::vector<vtkPolyData*>& tools, vtkPolyData* output);
+
+  int  OperationType     = vtkCGALBooleanOperation::DIFFERENCE;
+  bool LocalCorefinement = true;
+
+  // Source mesh reused between executions
+  struct SourceCache;
+  std::unique_ptr<SourceCache> CachedSource;
+
+  /**
+   * Return the cached source, converted again if it changed.
+   **/
+  SourceCache* UpdateSourceCache(vtkPolyData* source);
 
 private:
   vtkCGALBooleanOperation(const vtkCGALBooleanOperation&) = delete;
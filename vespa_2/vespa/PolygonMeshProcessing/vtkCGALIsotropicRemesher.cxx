@@ -54,6 +54,8 @@ int vtkCGALIsotropicRemesher::RequestData(
 
   try
   {
+    StageTimer stage(this, "isotropic_remeshing", num_faces(cgalMesh->surface));
+
     // protect feature edges:
     // https://doc.cgal.org/latest/Polygon_mesh_processing/Polygon_mesh_processing_2mesh_smoothing_example_8cpp-example.html#a3
     auto featureEdges = get(CGAL::edge_is_feature, cgalMesh->surface);
@@ -1,11 +1,26 @@
 #include "vtkCGALMeshChecker.h"
+#include "vtkCGALSelfIntersections.h"
+#include "vtkCGALSparseSolvers.h"
 
 // VTK related includes
+#include "vtkCellArray.h"
+#include "vtkCellArrayIterator.h"
+#include "vtkCellData.h"
+#include "vtkFieldData.h"
+#include "vtkIdTypeArray.h"
+#include "vtkInformation.h"
 #include "vtkInformationVector.h"
 #include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkSmartPointer.h"
+#include "vtkStringArray.h"
+#include "vtkTable.h"
+#include "vtkUnsignedCharArray.h"
 
 // VESPA related includes
 #include "vtkCGALPatchFilling.h"
+#include "vtkCGALPolyDataView.h"
 
 // CGAL related includes
 #include <CGAL/Polygon_mesh_processing/corefinement.h>
@@ -16,10 +31,374 @@
 #include <CGAL/Polygon_mesh_processing/border.h>
 #include <CGAL/Polygon_mesh_processing/triangulate_hole.h>
 
+// STL related includes
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <numeric>
+#include <utility>
+#include <vector>
+
 vtkStandardNewMacro(vtkCGALMeshChecker);
 
 namespace pmp = CGAL::Polygon_mesh_processing;
 
+namespace
+{
+using CellPairs = std::vector<std::pair<vtkIdType, vtkIdType>>;
+
+//------------------------------------------------------------------------------
+// Add the number of cells each cell intersects to the cell data of the mesh,
+// and the intersecting pairs of cell ids to its field data.
+void addSelfIntersections(vtkPolyData* mesh, const CellPairs& pairs)
+{
+  vtkNew<vtkIdTypeArray> counts;
+  counts->SetName("SelfIntersections");
+  counts->SetNumberOfTuples(mesh->GetNumberOfCells());
+  counts->Fill(0);
+
+  vtkNew<vtkIdTypeArray> cellPairs;
+  cellPairs->SetName("SelfIntersectingPairs");
+  cellPairs->SetNumberOfComponents(2);
+  cellPairs->SetNumberOfTuples(static_cast<vtkIdType>(pairs.size()));
+  for (std::size_t i = 0; i < pairs.size(); i++)
+  {
+    const vtkIdType pair[2] = { pairs[i].first, pairs[i].second };
+    cellPairs->SetTypedTuple(static_cast<vtkIdType>(i), pair);
+    counts->SetValue(pair[0], counts->GetValue(pair[0]) + 1);
+    counts->SetValue(pair[1], counts->GetValue(pair[1]) + 1);
+  }
+
+  // the field data may be shared with the input by a shallow copy
+  vtkNew<vtkFieldData> fd;
+  fd->ShallowCopy(mesh->GetFieldData());
+  mesh->SetFieldData(fd);
+  fd->AddArray(cellPairs);
+  mesh->GetCellData()->AddArray(counts);
+}
+
+//------------------------------------------------------------------------------
+// Root of an element in a union-find forest, with path halving.
+vtkIdType findRoot(std::vector<vtkIdType>& parent, vtkIdType id)
+{
+  while (parent[id] != id)
+  {
+    id = parent[id] = parent[parent[id]];
+  }
+  return id;
+}
+
+//------------------------------------------------------------------------------
+// Whether all the points of the polygon lie on a line, i.e. its area is null,
+// decided with exact predicates. The polygon must not repeat its point ids.
+bool isCollinear(vtkPoints* points, vtkIdType size, const vtkIdType* ids)
+{
+  double p[3];
+  points->GetPoint(ids[0], p);
+  const CGAL_Kernel::Point_3 a(p[0], p[1], p[2]);
+
+  // the line goes through the first point and the first one distinct from it
+  vtkIdType i = 1;
+  for (; i < size; i++)
+  {
+    points->GetPoint(ids[i], p);
+    if (CGAL_Kernel::Point_3(p[0], p[1], p[2]) != a)
+    {
+      break;
+    }
+  }
+  if (i == size)
+  {
+    return true;
+  }
+  const CGAL_Kernel::Point_3 b(p[0], p[1], p[2]);
+  for (i++; i < size; i++)
+  {
+    points->GetPoint(ids[i], p);
+    if (!CGAL::collinear(a, b, CGAL_Kernel::Point_3(p[0], p[1], p[2])))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// A corner of a polygon: its point and the previous and next points.
+struct Corner
+{
+  vtkIdType Point;
+  vtkIdType Prev;
+  vtkIdType Next;
+};
+
+//------------------------------------------------------------------------------
+// Diagnose the polys of the mesh with a single traversal of its cells,
+// followed by sorts of the collected corners and points. The flags are added
+// to the point and cell data of the mesh, and one row per defect to the
+// report. The intersecting pairs are nullptr when they were not checked.
+void addDefectReport(vtkPolyData* mesh, const CellPairs* intersections, vtkTable* report)
+{
+  const vtkIdType nbPoints  = mesh->GetNumberOfPoints();
+  const vtkIdType nbCells   = mesh->GetNumberOfCells();
+  const vtkIdType firstPoly = mesh->GetNumberOfVerts() + mesh->GetNumberOfLines();
+
+  // Polys traversal
+  // ---------------
+
+  // repeated points or all points on a line: vertices and lines are never degenerate
+  vtkNew<vtkUnsignedCharArray> degenerate;
+  degenerate->SetName("DegenerateFaces");
+  degenerate->SetNumberOfTuples(nbCells);
+  degenerate->Fill(0);
+  vtkIdType nbDegenerate = 0;
+
+  // points sharing an edge are in the same component
+  std::vector<vtkIdType> component(nbPoints);
+  std::iota(component.begin(), component.end(), 0);
+  std::vector<vtkIdType> polyPoint(mesh->GetNumberOfPolys(), -1);
+
+  std::vector<Corner> corners;
+  corners.reserve(mesh->GetPolys()->GetNumberOfConnectivityIds());
+
+  auto      polys = vtk::TakeSmartPointer(mesh->GetPolys()->NewIterator());
+  vtkIdType poly  = 0;
+  for (polys->GoToFirstCell(); !polys->IsDoneWithTraversal(); polys->GoToNextCell(), poly++)
+  {
+    vtkIdType        size;
+    const vtkIdType* ids;
+    polys->GetCurrentCell(size, ids);
+
+    bool repeated = size < 3;
+    for (vtkIdType i = 0; i < size; i++)
+    {
+      for (vtkIdType j = i + 1; j < size; j++)
+      {
+        repeated = repeated || ids[i] == ids[j];
+      }
+      component[::findRoot(component, ids[i])] = ::findRoot(component, ids[(i + 1) % size]);
+    }
+    if (size > 0)
+    {
+      polyPoint[poly] = ids[0];
+    }
+
+    if (repeated || ::isCollinear(mesh->GetPoints(), size, ids))
+    {
+      degenerate->SetValue(firstPoly + poly, 1);
+      nbDegenerate++;
+    }
+
+    // polygons with repeated points have no sensible edges nor fans
+    if (!repeated)
+    {
+      for (vtkIdType i = 0; i < size; i++)
+      {
+        corners.push_back({ ids[i], ids[(i + size - 1) % size], ids[(i + 1) % size] });
+      }
+    }
+  }
+
+  // Connected components
+  // --------------------
+
+  vtkNew<vtkIdTypeArray> components;
+  components->SetName("ComponentId");
+  components->SetNumberOfTuples(nbCells);
+  components->Fill(-1);
+  std::vector<vtkIdType> componentIndex(nbPoints, -1);
+  vtkIdType              nbComponents = 0;
+  for (std::size_t p = 0; p < polyPoint.size(); p++)
+  {
+    if (polyPoint[p] >= 0)
+    {
+      vtkIdType& index = componentIndex[::findRoot(component, polyPoint[p])];
+      if (index < 0)
+      {
+        index = nbComponents++;
+      }
+      components->SetValue(firstPoly + static_cast<vtkIdType>(p), index);
+    }
+  }
+
+  // Edges and border cycles
+  // -----------------------
+
+  // an edge used once is on the border, more than twice it is non-manifold
+  std::vector<std::pair<vtkIdType, vtkIdType>> edges;
+  edges.reserve(corners.size());
+  for (const Corner& corner : corners)
+  {
+    edges.emplace_back(std::min(corner.Point, corner.Next), std::max(corner.Point, corner.Next));
+  }
+  std::sort(edges.begin(), edges.end());
+
+  std::vector<vtkIdType> cycle(nbPoints);
+  std::iota(cycle.begin(), cycle.end(), 0);
+  std::vector<char> onBorder(nbPoints, 0);
+  vtkIdType         nbBorderEdges      = 0;
+  vtkIdType         nbNonManifoldEdges = 0;
+  for (std::size_t i = 0, j = 0; i < edges.size(); i = j)
+  {
+    while (j < edges.size() && edges[j] == edges[i])
+    {
+      j++;
+    }
+    if (j - i == 1)
+    {
+      nbBorderEdges++;
+      onBorder[edges[i].first] = onBorder[edges[i].second] = 1;
+      cycle[::findRoot(cycle, edges[i].first)] = ::findRoot(cycle, edges[i].second);
+    }
+    else if (j - i > 2)
+    {
+      nbNonManifoldEdges++;
+    }
+  }
+
+  // border cycles sharing a point are counted once
+  vtkNew<vtkIdTypeArray> borderCycles;
+  borderCycles->SetName("BorderCycle");
+  borderCycles->SetNumberOfTuples(nbPoints);
+  borderCycles->Fill(-1);
+  std::vector<vtkIdType> cycleIndex(nbPoints, -1);
+  vtkIdType              nbCycles = 0;
+  for (vtkIdType pid = 0; pid < nbPoints; pid++)
+  {
+    if (onBorder[pid])
+    {
+      vtkIdType& index = cycleIndex[::findRoot(cycle, pid)];
+      if (index < 0)
+      {
+        index = nbCycles++;
+      }
+      borderCycles->SetValue(pid, index);
+    }
+  }
+
+  // Non-manifold vertices
+  // ---------------------
+
+  // The link of a point is the graph of the (prev, next) pairs of its corners:
+  // the faces around the point form a single fan when the link is one path or
+  // one cycle, i.e. connected with no link point used more than twice.
+  vtkNew<vtkUnsignedCharArray> nonManifold;
+  nonManifold->SetName("NonManifoldVertices");
+  nonManifold->SetNumberOfTuples(nbPoints);
+  nonManifold->Fill(0);
+  vtkIdType nbNonManifold = 0;
+
+  std::sort(corners.begin(), corners.end(),
+    [](const Corner& a, const Corner& b) { return a.Point < b.Point; });
+
+  std::vector<vtkIdType> link, linkParent, linkDegree;
+  const auto             linkIndex = [&link](vtkIdType pid) {
+    return std::lower_bound(link.begin(), link.end(), pid) - link.begin();
+  };
+  for (std::size_t i = 0, j = 0; i < corners.size(); i = j)
+  {
+    link.clear();
+    while (j < corners.size() && corners[j].Point == corners[i].Point)
+    {
+      link.emplace_back(corners[j].Prev);
+      link.emplace_back(corners[j].Next);
+      j++;
+    }
+    std::sort(link.begin(), link.end());
+    link.erase(std::unique(link.begin(), link.end()), link.end());
+    linkParent.resize(link.size());
+    std::iota(linkParent.begin(), linkParent.end(), 0);
+    linkDegree.assign(link.size(), 0);
+
+    bool manifold = true;
+    for (std::size_t k = i; k < j; k++)
+    {
+      const vtkIdType prev = linkIndex(corners[k].Prev);
+      const vtkIdType next = linkIndex(corners[k].Next);
+      linkDegree[prev]++;
+      linkDegree[next]++;
+      manifold = manifold && linkDegree[prev] <= 2 && linkDegree[next] <= 2;
+      linkParent[::findRoot(linkParent, prev)] = ::findRoot(linkParent, next);
+    }
+    for (std::size_t k = 1; manifold && k < link.size(); k++)
+    {
+      manifold = ::findRoot(linkParent, static_cast<vtkIdType>(k)) == ::findRoot(linkParent, 0);
+    }
+
+    if (!manifold)
+    {
+      nonManifold->SetValue(corners[i].Point, 1);
+      nbNonManifold++;
+    }
+  }
+
+  // Duplicate vertices
+  // ------------------
+
+  // points sorted by coordinates then ids: each point refers to the first
+  // point with the same coordinates, the first ones refer to none
+  std::vector<std::array<double, 3>> coords(nbPoints);
+  for (vtkIdType pid = 0; pid < nbPoints; pid++)
+  {
+    mesh->GetPoint(pid, coords[pid].data());
+  }
+  std::vector<vtkIdType> order(nbPoints);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&coords](vtkIdType a, vtkIdType b) {
+    return coords[a] != coords[b] ? coords[a] < coords[b] : a < b;
+  });
+
+  vtkNew<vtkIdTypeArray> duplicates;
+  duplicates->SetName("DuplicateOf");
+  duplicates->SetNumberOfTuples(nbPoints);
+  duplicates->Fill(-1);
+  vtkIdType nbDuplicates = 0;
+  for (vtkIdType i = 1; i < nbPoints; i++)
+  {
+    if (coords[order[i]] == coords[order[i - 1]])
+    {
+      const vtkIdType first = duplicates->GetValue(order[i - 1]);
+      duplicates->SetValue(order[i], first < 0 ? order[i - 1] : first);
+      nbDuplicates++;
+    }
+  }
+
+  // Output
+  // ------
+
+  mesh->GetCellData()->AddArray(degenerate);
+  mesh->GetCellData()->AddArray(components);
+  mesh->GetPointData()->AddArray(borderCycles);
+  mesh->GetPointData()->AddArray(nonManifold);
+  mesh->GetPointData()->AddArray(duplicates);
+
+  vtkNew<vtkStringArray> defects;
+  defects->SetName("Defect");
+  vtkNew<vtkIdTypeArray> counts;
+  counts->SetName("Count");
+  const auto addRow = [&](const char* defect, vtkIdType count) {
+    defects->InsertNextValue(defect);
+    counts->InsertNextValue(count);
+  };
+  addRow("BorderEdges", nbBorderEdges);
+  addRow("BorderCycles", nbCycles);
+  addRow("NonManifoldEdges", nbNonManifoldEdges);
+  addRow("NonManifoldVertices", nbNonManifold);
+  addRow("DegenerateFaces", nbDegenerate);
+  addRow("DuplicateVertices", nbDuplicates);
+  addRow("ConnectedComponents", nbComponents);
+  addRow("SelfIntersectingPairs",
+    intersections ? static_cast<vtkIdType>(intersections->size()) : vtkIdType(-1));
+  report->AddColumn(defects);
+  report->AddColumn(counts);
+}
+}
+
+//------------------------------------------------------------------------------
+vtkCGALMeshChecker::vtkCGALMeshChecker()
+{
+  this->SetNumberOfOutputPorts(2);
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALMeshChecker::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -27,6 +406,24 @@ void vtkCGALMeshChecker::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "CheckWatertight: " << (this->CheckWatertight ? "True" : "False") << std::endl;
   os << indent << "CheckIntersect: " << (this->CheckIntersect ? "True" : "False") << std::endl;
   os << indent << "AttemptRepair: " << (this->AttemptRepair ? "True" : "False") << std::endl;
+  os << indent << "GenerateReport: " << (this->GenerateReport ? "True" : "False") << std::endl;
+}
+
+//------------------------------------------------------------------------------
+int vtkCGALMeshChecker::FillOutputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 1)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkTable");
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
+//------------------------------------------------------------------------------
+vtkTable* vtkCGALMeshChecker::GetReportOutput()
+{
+  return vtkTable::SafeDownCast(this->GetOutputDataObject(1));
 }
 
 //------------------------------------------------------------------------------
@@ -45,6 +442,72 @@ int vtkCGALMeshChecker::RequestData(
 
   vtkPolyData* output = vtkPolyData::GetData(outputVector);
 
+  // Read-only diagnosis on the VTK buffers
+  // --------------------------------------
+
+  // Without reparation, manifold triangulations can be checked
+  // in place, without building any CGAL mesh.
+  // cells of the polys, after the verts and lines
+  const vtkIdType firstPoly = input->GetNumberOfVerts() + input->GetNumberOfLines();
+  ::CellPairs     intersections;
+
+  if (!this->AttemptRepair)
+  {
+    Vespa_view cgalView;
+    if (this->toCGAL(input, &cgalView))
+    {
+      try
+      {
+        StageTimer stage(this, "check view", cgalView.number_of_faces());
+
+        if (this->CheckWatertight)
+        {
+          if (!CGAL::is_closed(cgalView))
+          {
+            vtkWarningMacro("Input is not closed.");
+          }
+          else if (!pmp::does_bound_a_volume(cgalView))
+          {
+            vtkWarningMacro("Input is not watertight.");
+          }
+        }
+
+        if (this->CheckIntersect)
+        {
+          std::vector<std::pair<Vespa_view_face, Vespa_view_face>> facePairs;
+          vtkCGALSelfIntersections(this, cgalView, std::back_inserter(facePairs));
+          if (!facePairs.empty())
+          {
+            vtkWarningMacro("Self intersection detected");
+          }
+          for (const auto& facePair : facePairs)
+          {
+            intersections.emplace_back(
+              firstPoly + facePair.first.idx(), firstPoly + facePair.second.idx());
+          }
+        }
+      }
+      catch (std::exception& e)
+      {
+        vtkErrorMacro("CGAL Exception during surface processing: " << e.what());
+        return 0;
+      }
+
+      output->ShallowCopy(input);
+      if (this->CheckIntersect)
+      {
+        ::addSelfIntersections(output, intersections);
+      }
+      if (this->GenerateReport)
+      {
+        StageTimer stage(this, "defect report", output->GetNumberOfCells());
+        ::addDefectReport(output, this->CheckIntersect ? &intersections : nullptr,
+          vtkTable::GetData(outputVector, 1));
+      }
+      return 1;
+    }
+  }
+
   // Create the soup meshes for CGAL
   // ----------------------------------
 
@@ -61,20 +524,41 @@ int vtkCGALMeshChecker::RequestData(
   // Tries to convert the soup into a surface
   try
   {
+    StageTimer stage(this, "soup processing", cgalSoup->number_of_faces());
+
     if (this->AttemptRepair)
     {
-      pmp::repair_polygon_soup(cgalSoup->points, cgalSoup->faces);
-      if (!pmp::orient_polygon_soup(cgalSoup->points, cgalSoup->faces))
+      // CGAL edits the soup in place: work on contiguous triangles when possible
+      auto repair = [&](auto& polygons) {
+        pmp::repair_polygon_soup(cgalSoup->points, polygons);
+        const bool oriented = pmp::orient_polygon_soup(cgalSoup->points, polygons);
+        cgalSoup->assign(polygons);
+        return oriented;
+      };
+
+      bool oriented = false;
+      if (cgalSoup->is_triangle_soup())
+      {
+        auto triangles = cgalSoup->to_triangles();
+        oriented       = repair(triangles);
+      }
+      else
+      {
+        auto polygons = cgalSoup->to_polygons();
+        oriented      = repair(polygons);
+      }
+
+      if (!oriented)
       {
         vtkWarningMacro("Failed to orient the polygon soup correctly.");
         return 0;
       }
     }
 
-    isSurface = pmp::is_polygon_soup_a_polygon_mesh(cgalSoup->faces);
+    isSurface = pmp::is_polygon_soup_a_polygon_mesh(cgalSoup->faces());
     if (isSurface)
     {
-      pmp::polygon_soup_to_polygon_mesh(cgalSoup->points, cgalSoup->faces, cgalSurface->surface);
+      pmp::polygon_soup_to_polygon_mesh(cgalSoup->points, cgalSoup->faces(), cgalSurface->surface);
     }
     else
     {
@@ -92,6 +576,8 @@ int vtkCGALMeshChecker::RequestData(
   // Now that we have a surface, inspect its properties
   try
   {
+    StageTimer stage(this, "surface processing", num_faces(cgalSurface->surface));
+
     if (isSurface && this->CheckWatertight)
     {
       bool closed = CGAL::is_closed(cgalSurface->surface);
@@ -107,12 +593,14 @@ int vtkCGALMeshChecker::RequestData(
           std::vector<Graph_Verts> patch_vertices;
           std::vector<Graph_Faces> patch_facets;
           // fill boundary cycles
-          for (Graph_halfedge h : borderCycles)
-          {
-            std::get<0>(pmp::triangulate_refine_and_fair_hole(cgalSurface->surface, h,
-              std::back_inserter(patch_facets), std::back_inserter(patch_vertices),
-              pmp::parameters::fairing_continuity(0)));
-          }
+          vtkCGALWithSolver(this, [&](auto solver) {
+            for (Graph_halfedge h : borderCycles)
+            {
+              pmp::triangulate_refine_and_fair_hole(cgalSurface->surface, h,
+                std::back_inserter(patch_facets), std::back_inserter(patch_vertices),
+                pmp::parameters::fairing_continuity(0).sparse_linear_solver(solver));
+            }
+          });
 
           // check reparation
           closed = CGAL::is_closed(cgalSurface->surface);
@@ -140,7 +628,9 @@ int vtkCGALMeshChecker::RequestData(
 
     if (isSurface && this->CheckIntersect)
     {
-      bool intersect = CGAL::Polygon_mesh_processing::does_self_intersect(cgalSurface->surface);
+      std::vector<std::pair<Graph_Faces, Graph_Faces>> facePairs;
+      vtkCGALSelfIntersections(this, cgalSurface->surface, std::back_inserter(facePairs));
+      bool intersect = !facePairs.empty();
       if (intersect)
       {
         vtkWarningMacro("Self intersection detected");
@@ -150,10 +640,26 @@ int vtkCGALMeshChecker::RequestData(
             cgalSurface->surface, pmp::parameters::preserve_genus(false));
 
           // check reparation
-          intersect = CGAL::Polygon_mesh_processing::does_self_intersect(cgalSurface->surface);
-          vtkWarningMacro("Remove intersection " << (intersect ? "successful." : "failed."));
+          facePairs.clear();
+          vtkCGALSelfIntersections(this, cgalSurface->surface, std::back_inserter(facePairs));
+          intersect = !facePairs.empty();
+          vtkWarningMacro("Remove intersection " << (intersect ? "failed." : "successful."));
         }
       }
+
+      // cell of each face in the output: the repaired surface without its
+      // removed faces, or the input polys
+      const CGAL_Surface&    surface = cgalSurface->surface;
+      std::vector<vtkIdType> faceCell(surface.num_faces(), -1);
+      vtkIdType              cid = this->AttemptRepair ? 0 : firstPoly;
+      for (Graph_Faces f : faces(surface))
+      {
+        faceCell[f] = cid++;
+      }
+      for (const auto& facePair : facePairs)
+      {
+        intersections.emplace_back(faceCell[facePair.first], faceCell[facePair.second]);
+      }
     }
   }
   catch (std::exception& e)
@@ -181,5 +687,18 @@ int vtkCGALMeshChecker::RequestData(
     output->ShallowCopy(input);
   }
 
+  const bool intersectChecked = isSurface && this->CheckIntersect;
+  if (intersectChecked)
+  {
+    ::addSelfIntersections(output, intersections);
+  }
+
+  if (this->GenerateReport)
+  {
+    StageTimer stage(this, "defect report", output->GetNumberOfCells());
+    ::addDefectReport(
+      output, intersectChecked ? &intersections : nullptr, vtkTable::GetData(outputVector, 1));
+  }
+
   return 1;
 }
@@ -4,6 +4,23 @@
  *
  * vtkCGALMeshChecker is a filter allowing to perform diagnosis on a mesh
  * to check manifoldness, auto-intersection, watertightness...
+ *
+ * When checking self intersections, the output has a SelfIntersections cell
+ * array with the number of cells each cell intersects, and a
+ * SelfIntersectingPairs field array with the pairs of intersecting cell ids.
+ * The check runs on NumberOfThreads threads when VESPA is built with TBB.
+ *
+ * When GenerateReport is on, the polys of the output mesh are diagnosed
+ * in a single traversal, and the filter has a second output: a vtkTable with
+ * a "Defect" and a "Count" column, and one row for each of BorderEdges,
+ * BorderCycles, NonManifoldEdges, NonManifoldVertices, DegenerateFaces,
+ * DuplicateVertices, ConnectedComponents and SelfIntersectingPairs (-1 when
+ * not checked). The output mesh gets the matching flags:
+ *   - cell arrays: DegenerateFaces (repeated points or all points on a line) and
+ *     ComponentId (-1 for vertices and lines),
+ *   - point arrays: BorderCycle (-1 outside the border), NonManifoldVertices
+ *     and DuplicateOf (first point with the same coordinates, or -1).
+ * With AttemptRepair, the report describes the repaired mesh.
  */
 
 #ifndef vtkCGALMeshChecker_h
@@ -13,6 +30,8 @@
 
 #include "vtkCGALPMPModule.h" // For export macro
 
+class vtkTable;
+
 class VTKCGALPMP_EXPORT vtkCGALMeshChecker : public vtkCGALPolyDataAlgorithm
 {
 public:
@@ -56,17 +75,34 @@ public:
   vtkBooleanMacro(AttemptRepair, bool);
   // }@
 
+  // {@
+  /**
+   *   Set / Get the GenerateReport property, default: true
+   *   If true, flag the defects of the output mesh
+   *   and count them in the report output.
+   */
+  vtkGetMacro(GenerateReport, bool);
+  vtkSetMacro(GenerateReport, bool);
+  vtkBooleanMacro(GenerateReport, bool);
+  // }@
+
+  /**
+   * Get the report output, on port 1.
+   */
+  vtkTable* GetReportOutput();
 
 protected:
-  vtkCGALMeshChecker()           = default;
+  vtkCGALMeshChecker();
   ~vtkCGALMeshChecker() override = default;
 
   int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
 
   // fields
   bool CheckWatertight  = true;
   bool CheckIntersect   = true;
   bool AttemptRepair = false;
+  bool GenerateReport   = true;
 
 private:
   vtkCGALMeshChecker(const vtkCGALMeshChecker&) = delete;
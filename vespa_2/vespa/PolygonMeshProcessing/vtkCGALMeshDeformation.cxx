@@ -1,22 +1,730 @@
 #include "vtkCGALMeshDeformation.h"
+#include "vtkCGALSparseSolvers.h"
 
 // VTK related includes
+#include "vtkCellArray.h"
+#include "vtkCompositeDataIterator.h"
+#include "vtkDataArrayRange.h"
+#include "vtkDemandDrivenPipeline.h"
 #include "vtkExtractSelection.h"
 #include "vtkInformation.h"
 #include "vtkInformationVector.h"
+#include "vtkMath.h"
+#include "vtkMultiBlockDataSet.h"
 #include "vtkObjectFactory.h"
 #include "vtkPointData.h"
 #include "vtkPointSet.h"
+#include "vtkPoints.h"
+#include "vtkSMPTools.h"
 #include "vtkSelection.h"
+#include "vtkSmartPointer.h"
 
 // CGAL related includes
+#include <CGAL/AABB_face_graph_triangle_primitive.h>
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_tree.h>
 #include <CGAL/Surface_mesh_deformation.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Constrained_placement.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/Edge_count_ratio_stop_predicate.h>
+#include <CGAL/Surface_mesh_simplification/Policies/Edge_collapse/LindstromTurk_placement.h>
+#include <CGAL/Surface_mesh_simplification/edge_collapse.h>
+
+// STL related includes
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 vtkStandardNewMacro(vtkCGALMeshDeformation);
 
-using SmoothDeformation = CGAL::Surface_mesh_deformation<CGAL_Surface>;
-using SRE_ARAPDeformation =
-  CGAL::Surface_mesh_deformation<CGAL_Surface, CGAL::Default, CGAL::Default, CGAL::SRE_ARAP>;
+namespace
+{
+//------------------------------------------------------------------------------
+// Point index of each global ID, in an open addressing hash table
+class GlobalIdIndex
+{
+public:
+  // Return false if a global ID is duplicated
+  bool Build(vtkDataArray* gids)
+  {
+    const auto      range = vtk::DataArrayValueRange<1>(gids);
+    const vtkIdType nbIds = gids->GetNumberOfTuples();
+    this->Keys.clear();
+    this->Values.clear();
+
+    // no table needed when global IDs are the point indices
+    this->Identity = true;
+    for (vtkIdType pid = 0; pid < nbIds && this->Identity; pid++)
+    {
+      this->Identity = static_cast<vtkIdType>(range[pid]) == pid;
+    }
+    this->Size = nbIds;
+    if (this->Identity)
+    {
+      return true;
+    }
+
+    std::size_t capacity = 16;
+    while (capacity < 2 * static_cast<std::size_t>(nbIds))
+    {
+      capacity *= 2;
+    }
+    this->Mask = capacity - 1;
+    this->Keys.resize(capacity);
+    this->Values.assign(capacity, -1);
+    for (vtkIdType pid = 0; pid < nbIds; pid++)
+    {
+      const vtkIdType gid  = static_cast<vtkIdType>(range[pid]);
+      std::size_t     slot = GlobalIdIndex::Hash(gid) & this->Mask;
+      while (this->Values[slot] != -1)
+      {
+        if (this->Keys[slot] == gid)
+        {
+          return false;
+        }
+        slot = (slot + 1) & this->Mask;
+      }
+      this->Keys[slot]   = gid;
+      this->Values[slot] = pid;
+    }
+    return true;
+  }
+
+  // Return -1 if the global ID is unknown
+  vtkIdType Find(vtkIdType gid) const
+  {
+    if (this->Identity)
+    {
+      return gid >= 0 && gid < this->Size ? gid : -1;
+    }
+    if (this->Values.empty())
+    {
+      return -1;
+    }
+    for (std::size_t slot = GlobalIdIndex::Hash(gid) & this->Mask; this->Values[slot] != -1;
+         slot             = (slot + 1) & this->Mask)
+    {
+      if (this->Keys[slot] == gid)
+      {
+        return this->Values[slot];
+      }
+    }
+    return -1;
+  }
+
+private:
+  static std::size_t Hash(vtkIdType key)
+  {
+    // splitmix64 finalizer, spreads consecutive IDs
+    std::uint64_t x = static_cast<std::uint64_t>(key);
+    x               = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x               = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return static_cast<std::size_t>(x ^ (x >> 31));
+  }
+
+  bool                   Identity = false;
+  vtkIdType              Size     = 0;
+  std::size_t            Mask     = 0;
+  std::vector<vtkIdType> Keys;
+  std::vector<vtkIdType> Values;
+};
+
+//------------------------------------------------------------------------------
+// A full resolution point moved by a triangle of the proxy
+struct ProxyCoordinates
+{
+  vtkIdType   Point;
+  Graph_Verts Vertices[3];
+  double      Weights[3];
+};
+
+//------------------------------------------------------------------------------
+// Surface_mesh_deformation of any algorithm and solver
+class DeformerBase
+{
+public:
+  virtual ~DeformerBase() = default;
+
+  // Insert the ROI and control vertices, then factorize the system
+  virtual bool Prepare(
+    const std::vector<Graph_Verts>& roi, const std::vector<Graph_Verts>& controls) = 0;
+
+  // Move the controls to the points of targets of the given indices
+  virtual void SetTargets(const std::vector<Graph_Verts>& controls,
+    const std::vector<vtkIdType>& targetIds, vtkPointSet* targets) = 0;
+
+  // Run one iteration and return the change of the ROI during it, relative to
+  // its displacement since the targets were set
+  virtual double Iterate() = 0;
+
+  // Move the ROI back to its rest positions, the next deformation preprocesses again
+  virtual void Reset() = 0;
+
+  // Move the controls, then iterate until the relative change is below the tolerance
+  void Deform(const std::vector<Graph_Verts>& controls, const std::vector<vtkIdType>& targetIds,
+    vtkPointSet* targets, unsigned int nbIterations, double tolerance)
+  {
+    this->SetTargets(controls, targetIds, targets);
+    for (unsigned int it = 0; it < nbIterations; it++)
+    {
+      if (this->Iterate() < tolerance)
+      {
+        break;
+      }
+    }
+  }
+};
+
+template <CGAL::Deformation_algorithm_tag Tag, class Solver>
+class Deformer : public DeformerBase
+{
+public:
+  using Deformation = CGAL::Surface_mesh_deformation<CGAL_Surface, CGAL::Default, CGAL::Default,
+    Tag, CGAL::Default, Solver>;
+
+  Deformer(CGAL_Surface& mesh, double sreAlpha)
+    : Mesh(mesh)
+    , Impl(mesh)
+  {
+    if (Tag == CGAL::SRE_ARAP)
+    {
+      this->Impl.set_sre_arap_alpha(sreAlpha);
+    }
+  }
+
+  bool Prepare(
+    const std::vector<Graph_Verts>& roi, const std::vector<Graph_Verts>& controls) override
+  {
+    this->Impl.insert_roi_vertices(roi.begin(), roi.end());
+    this->Impl.insert_control_vertices(controls.begin(), controls.end());
+    return this->Impl.preprocess();
+  }
+
+  void SetTargets(const std::vector<Graph_Verts>& controls,
+    const std::vector<vtkIdType>& targetIds, vtkPointSet* targets) override
+  {
+    for (std::size_t i = 0; i < controls.size(); ++i)
+    {
+      double coords[3] = { 0.0, 0.0, 0.0 };
+      targets->GetPoint(targetIds[i], coords);
+      this->Impl.set_target_position(
+        controls[i], typename Deformation::Point(coords[0], coords[1], coords[2]));
+    }
+
+    this->Start.clear();
+    for (Graph_Verts v : this->Impl.roi_vertices())
+    {
+      this->Start.emplace_back(this->Mesh.point(v));
+    }
+    this->Previous = this->Start;
+  }
+
+  // CGAL does not expose the energy, the convergence is measured on the positions
+  double Iterate() override
+  {
+    this->Impl.deform(1, 0.);
+
+    double      step = 0., displacement = 0.;
+    std::size_t i = 0;
+    for (Graph_Verts v : this->Impl.roi_vertices())
+    {
+      const CGAL_Kernel::Point_3& p = this->Mesh.point(v);
+      step += CGAL::squared_distance(p, this->Previous[i]);
+      displacement += CGAL::squared_distance(p, this->Start[i]);
+      this->Previous[i++] = p;
+    }
+    return displacement > 0. ? std::sqrt(step / displacement) : 0.;
+  }
+
+  void Reset() override { this->Impl.reset(); }
+
+private:
+  CGAL_Surface& Mesh;
+  Deformation   Impl;
+
+  // ROI positions when the targets were set and after the last iteration
+  std::vector<CGAL_Kernel::Point_3> Start;
+  std::vector<CGAL_Kernel::Point_3> Previous;
+};
+
+//------------------------------------------------------------------------------
+// The direct solver shares its factorizations through the Scope of the caller,
+// the solvers of all the backends count their factorizations in it
+template <CGAL::Deformation_algorithm_tag Tag>
+std::unique_ptr<DeformerBase> makeDeformer(
+  vtkCGALPolyDataAlgorithm* self, CGAL_Surface& mesh, double sreAlpha)
+{
+  std::unique_ptr<DeformerBase> deformer;
+  if (self->GetSolverBackend() == vtkCGALPolyDataAlgorithm::DIRECT_SOLVER)
+  {
+    deformer = std::make_unique<Deformer<Tag, Vespa_cached_direct_solver>>(mesh, sreAlpha);
+    return deformer;
+  }
+  vtkCGALWithSolver(self, [&](auto solver) {
+    deformer =
+      std::make_unique<Deformer<Tag, Vespa_counted_solver<decltype(solver)>>>(mesh, sreAlpha);
+  });
+  return deformer;
+}
+
+//------------------------------------------------------------------------------
+// Deformation of the mesh in the mode of the filter
+std::unique_ptr<DeformerBase> makeDeformer(vtkCGALMeshDeformation* self, CGAL_Surface& mesh)
+{
+  switch (self->GetMode())
+  {
+    case vtkCGALMeshDeformation::SRE_ARAP:
+      return ::makeDeformer<CGAL::SRE_ARAP>(self, mesh, self->GetSreAlpha());
+    default:
+      return ::makeDeformer<CGAL::SPOKES_AND_RIMS>(self, mesh, self->GetSreAlpha());
+  }
+}
+
+//------------------------------------------------------------------------------
+// An independent deformation problem: a part of the ROI, with its control
+// points, deformed on its own mesh
+struct DeformationPart
+{
+  // the mesh is declared first as the deformer keeps a reference on it
+  std::unique_ptr<Vespa_surface> Mesh;
+  std::unique_ptr<DeformerBase>  Deformer;
+
+  // ROI and control vertices of the mesh, and the target point of each control
+  std::vector<Graph_Verts> Roi;
+  std::vector<Graph_Verts> Handles;
+  std::vector<vtkIdType>   Targets;
+
+  // input point of each mesh vertex, empty if the mesh is the whole input
+  std::vector<vtkIdType> MeshToInput;
+
+  // with a proxy, coordinates of the ROI points in the proxy and its rest positions
+  std::vector<ProxyCoordinates>     Proxy;
+  std::vector<CGAL_Kernel::Point_3> ProxyRest;
+};
+}
+
+//------------------------------------------------------------------------------
+struct vtkCGALMeshDeformation::Session
+{
+  // independent deformation problems, solved in parallel
+  std::vector<DeformationPart> Parts;
+
+  // input point of each global ID
+  GlobalIdIndex Index;
+
+  // factorizations of the parts, shared with the deformers of a batch
+  Vespa_factorizations Memory;
+
+  // state the deformation system was built for
+  std::vector<vtkIdType> Controls;
+  vtkMTimeType           InputTime     = 0;
+  vtkMTimeType           SelectionTime = 0;
+  int                    Mode          = SMOOTH;
+  double                 SreAlpha      = 0.;
+  int                    SolverBackend = DIRECT_SOLVER;
+  double                 RoiRadius     = 0.;
+  double                 ProxyRatio    = 1.;
+  bool                   Local         = false;
+  std::string            GlobalIdArray;
+};
+
+namespace
+{
+//------------------------------------------------------------------------------
+// Call the function with each neighbor of the point along the cell edges.
+// The mesh must have its links built.
+template <class Function>
+void forEachNeighbor(vtkPolyData* mesh, vtkIdType pid, Function&& function)
+{
+  vtkIdType  nbCells;
+  vtkIdType* cells;
+  mesh->GetPointCells(pid, nbCells, cells);
+  for (vtkIdType c = 0; c < nbCells; c++)
+  {
+    vtkIdType        npts;
+    const vtkIdType* pts;
+    mesh->GetCellPoints(cells[c], npts, pts);
+    const vtkIdType k = std::find(pts, pts + npts, pid) - pts;
+    for (vtkIdType w : { pts[(k + 1) % npts], pts[(k + npts - 1) % npts] })
+    {
+      function(w);
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// Points within a distance along the edges from the seeds, found by a Dijkstra
+// front that stops at the radius and only visits the points it reaches.
+// The mesh must have its links built.
+std::vector<vtkIdType> growRoi(
+  vtkPolyData* mesh, const std::vector<vtkIdType>& seeds, double radius)
+{
+  using Front = std::pair<double, vtkIdType>;
+  std::priority_queue<Front, std::vector<Front>, std::greater<Front>> front;
+  std::unordered_map<vtkIdType, double>                               distance;
+  for (vtkIdType pid : seeds)
+  {
+    distance[pid] = 0.;
+    front.emplace(0., pid);
+  }
+
+  std::vector<vtkIdType> roi;
+  double                 p[3], q[3];
+  while (!front.empty())
+  {
+    const Front top = front.top();
+    front.pop();
+    if (top.first > distance[top.second])
+    {
+      continue; // already reached by a shorter path
+    }
+    roi.emplace_back(top.second);
+    mesh->GetPoint(top.second, p);
+
+    ::forEachNeighbor(mesh, top.second, [&](vtkIdType w) {
+      mesh->GetPoint(w, q);
+      const double d = top.first + std::sqrt(vtkMath::Distance2BetweenPoints(p, q));
+      if (d > radius)
+      {
+        return;
+      }
+      auto it = distance.find(w);
+      if (it == distance.end() || d < it->second)
+      {
+        distance[w] = d;
+        front.emplace(d, w);
+      }
+    });
+  }
+
+  // a point may be pushed twice with the same distance
+  std::sort(roi.begin(), roi.end());
+  roi.erase(std::unique(roi.begin(), roi.end()), roi.end());
+  return roi;
+}
+
+//------------------------------------------------------------------------------
+// Connected component of each point of the sorted ROI. Two ROI points interact
+// when a path of at most 3 edges outside the ROI joins them: their fixed 1-rings
+// then share a point or an edge, and the rotations estimated on these rings
+// depend on both regions. The mesh must have its links built.
+std::vector<int> roiComponents(
+  vtkPolyData* mesh, const std::vector<vtkIdType>& roi, int& nbComponents)
+{
+  const auto roiIndex = [&roi](vtkIdType pid) -> std::ptrdiff_t {
+    auto it = std::lower_bound(roi.begin(), roi.end(), pid);
+    return it != roi.end() && *it == pid ? it - roi.begin() : -1;
+  };
+  const int interactionDistance = 3;
+
+  std::vector<int>              labels(roi.size(), -1);
+  std::vector<std::ptrdiff_t>   stack;
+  std::vector<vtkIdType>        ring, nextRing;
+  std::unordered_set<vtkIdType> visited;
+  nbComponents = 0;
+  for (std::size_t seed = 0; seed < roi.size(); seed++)
+  {
+    if (labels[seed] >= 0)
+    {
+      continue;
+    }
+    labels[seed] = nbComponents;
+    stack.emplace_back(seed);
+    while (!stack.empty())
+    {
+      const vtkIdType pid = roi[stack.back()];
+      stack.pop_back();
+
+      // breadth-first rings around the point, only crossing points outside the ROI
+      ring.assign(1, pid);
+      visited.clear();
+      visited.insert(pid);
+      for (int d = 0; d < interactionDistance && !ring.empty(); d++)
+      {
+        nextRing.clear();
+        for (vtkIdType v : ring)
+        {
+          ::forEachNeighbor(mesh, v, [&](vtkIdType w) {
+            if (!visited.insert(w).second)
+            {
+              return;
+            }
+            const std::ptrdiff_t idx = roiIndex(w);
+            if (idx < 0)
+            {
+              nextRing.emplace_back(w);
+            }
+            else if (labels[idx] < 0)
+            {
+              labels[idx] = nbComponents;
+              stack.emplace_back(idx);
+            }
+          });
+        }
+        std::swap(ring, nextRing);
+      }
+    }
+    nbComponents++;
+  }
+  return labels;
+}
+
+//------------------------------------------------------------------------------
+// The polygons around the ROI points and their neighbors, with the mesh point
+// of each submesh point. CGAL deforms the ROI with its fixed 1-ring and
+// estimates the rotations of the 1-ring from its own neighbors, so the whole
+// stencil of the problem is in the submesh. The mesh must have its links built.
+vtkSmartPointer<vtkPolyData> extractSubmesh(
+  vtkPolyData* mesh, const std::vector<vtkIdType>& pids, std::vector<vtkIdType>& subToMesh)
+{
+  std::vector<vtkIdType> ringIds(pids);
+  for (vtkIdType pid : pids)
+  {
+    vtkIdType  nbCells;
+    vtkIdType* cells;
+    mesh->GetPointCells(pid, nbCells, cells);
+    for (vtkIdType c = 0; c < nbCells; c++)
+    {
+      vtkIdType        npts;
+      const vtkIdType* pts;
+      mesh->GetCellPoints(cells[c], npts, pts);
+      ringIds.insert(ringIds.end(), pts, pts + npts);
+    }
+  }
+  std::sort(ringIds.begin(), ringIds.end());
+  ringIds.erase(std::unique(ringIds.begin(), ringIds.end()), ringIds.end());
+
+  std::vector<vtkIdType> cellIds;
+  for (vtkIdType pid : ringIds)
+  {
+    vtkIdType  nbCells;
+    vtkIdType* cells;
+    mesh->GetPointCells(pid, nbCells, cells);
+    cellIds.insert(cellIds.end(), cells, cells + nbCells);
+  }
+  std::sort(cellIds.begin(), cellIds.end());
+  cellIds.erase(std::unique(cellIds.begin(), cellIds.end()), cellIds.end());
+
+  std::unordered_map<vtkIdType, vtkIdType> meshToSub;
+  vtkNew<vtkPoints>                        subPoints;
+  subPoints->SetDataType(mesh->GetPoints()->GetDataType());
+  vtkNew<vtkCellArray> subPolys;
+  for (vtkIdType cellId : cellIds)
+  {
+    const int type = mesh->GetCellType(cellId);
+    if (type != VTK_TRIANGLE && type != VTK_QUAD && type != VTK_POLYGON)
+    {
+      continue;
+    }
+    vtkIdType        npts;
+    const vtkIdType* pts;
+    mesh->GetCellPoints(cellId, npts, pts);
+    subPolys->InsertNextCell(npts);
+    for (vtkIdType i = 0; i < npts; i++)
+    {
+      auto inserted = meshToSub.emplace(pts[i], subPoints->GetNumberOfPoints());
+      if (inserted.second)
+      {
+        subPoints->InsertNextPoint(mesh->GetPoint(pts[i]));
+        subToMesh.emplace_back(pts[i]);
+      }
+      subPolys->InsertCellPoint(inserted.first->second);
+    }
+  }
+
+  auto submesh = vtkSmartPointer<vtkPolyData>::New();
+  submesh->SetPoints(subPoints);
+  submesh->SetPolys(subPolys);
+  return submesh;
+}
+
+//------------------------------------------------------------------------------
+// Collapse the edges between free vertices until the ratio of edges is reached.
+// The other vertices and the border are kept as they are. The mesh is then
+// compacted, its vertex origins still give the vertices before decimation.
+void decimateProxy(Vespa_surface& proxy, const std::vector<bool>& isFree, double ratio)
+{
+  namespace SMS = CGAL::Surface_mesh_simplification;
+
+  using Graph_Edges  = boost::graph_traits<CGAL_Surface>::edge_descriptor;
+  CGAL_Surface& mesh = proxy.surface;
+
+  auto fixedEdges = mesh.add_property_map<Graph_Edges, bool>("e:vespa_proxy_fixed", false).first;
+  for (Graph_Edges e : edges(mesh))
+  {
+    const Graph_Verts v0 = source(e, mesh);
+    const Graph_Verts v1 = target(e, mesh);
+    put(fixedEdges, e,
+      is_border(e, mesh) || !isFree[static_cast<std::size_t>(v0)] ||
+        !isFree[static_cast<std::size_t>(v1)]);
+  }
+
+  using Placement =
+    SMS::Constrained_placement<SMS::LindstromTurk_placement<CGAL_Surface>, decltype(fixedEdges)>;
+  SMS::edge_collapse(mesh, SMS::Edge_count_ratio_stop_predicate<CGAL_Surface>(ratio),
+    CGAL::parameters::edge_is_constrained_map(fixedEdges).get_placement(Placement(fixedEdges)));
+
+  mesh.remove_property_map(fixedEdges);
+  mesh.collect_garbage();
+}
+
+//------------------------------------------------------------------------------
+// Barycentric coordinates of the points in the closest triangle of the proxy,
+// the points being the origins of the given proxy vertices
+std::vector<ProxyCoordinates> locateInProxy(
+  const CGAL_Surface& proxy, vtkPointSet* points, const std::vector<vtkIdType>& pids)
+{
+  using Primitive = CGAL::AABB_face_graph_triangle_primitive<CGAL_Surface>;
+  using Tree      = CGAL::AABB_tree<CGAL::AABB_traits<CGAL_Kernel, Primitive>>;
+  Tree tree(faces(proxy).first, faces(proxy).second, proxy);
+  tree.accelerate_distance_queries();
+
+  std::vector<ProxyCoordinates> coordinates(pids.size());
+  vtkSMPTools::For(0, static_cast<vtkIdType>(pids.size()), [&](vtkIdType begin, vtkIdType end) {
+    for (vtkIdType i = begin; i < end; i++)
+    {
+      ProxyCoordinates& coords = coordinates[i];
+      double            p[3];
+      points->GetPoint(pids[i], p);
+      const CGAL_Kernel::Point_3 query(p[0], p[1], p[2]);
+      const auto                 closest = tree.closest_point_and_primitive(query);
+
+      int k = 0;
+      for (Graph_Verts v : vertices_around_face(halfedge(closest.second, proxy), proxy))
+      {
+        coords.Vertices[k++] = v;
+      }
+      coords.Point = pids[i];
+
+      // coordinates of the closest point, which lies in the triangle
+      const CGAL_Kernel::Point_3& a   = proxy.point(coords.Vertices[0]);
+      const CGAL_Kernel::Vector_3 e1  = proxy.point(coords.Vertices[1]) - a;
+      const CGAL_Kernel::Vector_3 e2  = proxy.point(coords.Vertices[2]) - a;
+      const CGAL_Kernel::Vector_3 ep  = closest.first - a;
+      const double                d11 = e1 * e1;
+      const double                d12 = e1 * e2;
+      const double                d22 = e2 * e2;
+      const double                det = d11 * d22 - d12 * d12;
+      const double u = det > 0. ? (d22 * (ep * e1) - d12 * (ep * e2)) / det : 0.;
+      const double v = det > 0. ? (d11 * (ep * e2) - d12 * (ep * e1)) / det : 0.;
+      coords.Weights[0] = 1. - u - v;
+      coords.Weights[1] = u;
+      coords.Weights[2] = v;
+    }
+  });
+  return coordinates;
+}
+
+//------------------------------------------------------------------------------
+// Replace the mesh of the part by its proxy, and locate the ROI points in it
+void makeProxy(DeformationPart& part, vtkPointSet* input, double ratio)
+{
+  Vespa_surface&    mesh      = *part.Mesh;
+  const std::size_t nbMeshPts = mesh.surface.number_of_vertices();
+  std::vector<bool> isFree(nbMeshPts, false);
+  for (Graph_Verts v : part.Roi)
+  {
+    isFree[static_cast<std::size_t>(v)] = true;
+  }
+  for (Graph_Verts v : part.Handles)
+  {
+    isFree[static_cast<std::size_t>(v)] = false;
+  }
+  ::decimateProxy(mesh, isFree, ratio);
+
+  // vertices of the proxy, by their vertex before decimation
+  std::vector<Graph_Verts> toProxy(nbMeshPts);
+  for (Graph_Verts v : vertices(mesh.surface))
+  {
+    toProxy[get(mesh.vertex_origin, v)] = v;
+    part.ProxyRest.emplace_back(mesh.surface.point(v));
+  }
+
+  // coordinates of the full resolution ROI in the rest proxy
+  std::vector<vtkIdType> roiPids;
+  for (Graph_Verts v : part.Roi)
+  {
+    roiPids.emplace_back(part.MeshToInput[static_cast<std::size_t>(v)]);
+  }
+  part.Proxy = ::locateInProxy(mesh.surface, input, roiPids);
+
+  // the control vertices are never collapsed
+  for (Graph_Verts& v : part.Roi)
+  {
+    v = toProxy[static_cast<std::size_t>(v)];
+  }
+  part.Roi.erase(std::remove(part.Roi.begin(), part.Roi.end(), Graph_Verts()), part.Roi.end());
+  for (Graph_Verts& v : part.Handles)
+  {
+    v = toProxy[static_cast<std::size_t>(v)];
+  }
+}
+
+//------------------------------------------------------------------------------
+// Move the ROI of a copy of the mesh of the part back to its rest positions
+void restoreRoi(const DeformationPart& part, CGAL_Surface& mesh, vtkPointSet* input)
+{
+  for (Graph_Verts v : part.Roi)
+  {
+    const std::size_t vid = static_cast<std::size_t>(v);
+    if (!part.Proxy.empty())
+    {
+      mesh.point(v) = part.ProxyRest[vid];
+      continue;
+    }
+    double p[3];
+    input->GetPoint(part.MeshToInput.empty() ? vid : part.MeshToInput[vid], p);
+    mesh.point(v) = CGAL_Kernel::Point_3(p[0], p[1], p[2]);
+  }
+}
+
+//------------------------------------------------------------------------------
+// Set the input points of the ROI of the part to their position in its deformed mesh
+void writeDeformedRoi(
+  const DeformationPart& part, const CGAL_Surface& mesh, vtkPointSet* input, vtkPoints* points)
+{
+  if (part.Proxy.empty())
+  {
+    for (Graph_Verts v : part.Roi)
+    {
+      const CGAL_Kernel::Point_3& p   = mesh.point(v);
+      vtkIdType                   pid = static_cast<vtkIdType>(v);
+      if (!part.MeshToInput.empty())
+      {
+        pid = part.MeshToInput[pid];
+      }
+      points->SetPoint(pid, p.x(), p.y(), p.z());
+    }
+    return;
+  }
+
+  // the ROI points follow the displacement of their proxy triangle
+  vtkSMPTools::For(0, static_cast<vtkIdType>(part.Proxy.size()),
+    [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType i = begin; i < end; i++)
+      {
+        const ProxyCoordinates& coords = part.Proxy[i];
+        double                  p[3];
+        input->GetPoint(coords.Point, p);
+        for (int k = 0; k < 3; k++)
+        {
+          const Graph_Verts           v    = coords.Vertices[k];
+          const CGAL_Kernel::Point_3& rest = part.ProxyRest[static_cast<std::size_t>(v)];
+          const CGAL_Kernel::Vector_3 d    = mesh.point(v) - rest;
+          p[0] += coords.Weights[k] * d.x();
+          p[1] += coords.Weights[k] * d.y();
+          p[2] += coords.Weights[k] * d.z();
+        }
+        points->SetPoint(coords.Point, p);
+      }
+    });
+}
+}
 
 //------------------------------------------------------------------------------
 vtkCGALMeshDeformation::vtkCGALMeshDeformation()
@@ -24,6 +732,15 @@ vtkCGALMeshDeformation::vtkCGALMeshDeformation()
   this->SetNumberOfInputPorts(3);
 }
 
+//------------------------------------------------------------------------------
+vtkCGALMeshDeformation::~vtkCGALMeshDeformation() = default;
+
+//------------------------------------------------------------------------------
+void vtkCGALMeshDeformation::ReleaseSession()
+{
+  this->CurrentSession.reset();
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALMeshDeformation::PrintSelf(ostream& os, vtkIndent indent)
 {
@@ -31,9 +748,47 @@ void vtkCGALMeshDeformation::PrintSelf(ostream& os, vtkIndent indent)
   os << indent << "SreAlpha : " << this->SreAlpha << std::endl;
   os << indent << "Number of Iterations :" << this->NumberOfIterations << std::endl;
   os << indent << "Tolerance :" << this->Tolerance << std::endl;
+  os << indent << "IntermediateResults :" << this->IntermediateResults << std::endl;
+  os << indent << "RoiRadius :" << this->RoiRadius << std::endl;
+  os << indent << "LocalDeformation :" << this->LocalDeformation << std::endl;
+  os << indent << "ProxyRatio :" << this->ProxyRatio << std::endl;
+  os << indent << "FactorizationCacheDirectory :" << this->FactorizationCacheDirectory
+     << std::endl;
   this->Superclass::PrintSelf(os, indent);
 }
 
+//------------------------------------------------------------------------------
+vtkTypeBool vtkCGALMeshDeformation::ProcessRequest(
+  vtkInformation* request, vtkInformationVector** inInfo, vtkInformationVector* outInfo)
+{
+  if (request->Has(vtkDemandDrivenPipeline::REQUEST_DATA_OBJECT()))
+  {
+    return this->RequestDataObject(request, inInfo, outInfo);
+  }
+  return this->Superclass::ProcessRequest(request, inInfo, outInfo);
+}
+
+//------------------------------------------------------------------------------
+int vtkCGALMeshDeformation::RequestDataObject(
+  vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
+{
+  // a batch of target sets gives a batch of deformed meshes
+  const bool batch =
+    vtkMultiBlockDataSet::SafeDownCast(vtkDataObject::GetData(inputVector[1])) != nullptr;
+
+  vtkInformation* outInfo = outputVector->GetInformationObject(0);
+  vtkDataObject*  output  = vtkDataObject::GetData(outInfo);
+  if (batch && !vtkMultiBlockDataSet::SafeDownCast(output))
+  {
+    outInfo->Set(vtkDataObject::DATA_OBJECT(), vtkSmartPointer<vtkMultiBlockDataSet>::New());
+  }
+  else if (!batch && !vtkPolyData::SafeDownCast(output))
+  {
+    outInfo->Set(vtkDataObject::DATA_OBJECT(), vtkSmartPointer<vtkPolyData>::New());
+  }
+  return 1;
+}
+
 //------------------------------------------------------------------------------
 int vtkCGALMeshDeformation::FillInputPortInformation(int port, vtkInformation* info)
 {
@@ -44,6 +799,7 @@ int vtkCGALMeshDeformation::FillInputPortInformation(int port, vtkInformation* i
   else if (port == 1)
   {
     info->Set(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkPointSet");
+    info->Append(vtkAlgorithm::INPUT_REQUIRED_DATA_TYPE(), "vtkMultiBlockDataSet");
   }
   else
   {
@@ -54,6 +810,14 @@ int vtkCGALMeshDeformation::FillInputPortInformation(int port, vtkInformation* i
   return 1;
 }
 
+//------------------------------------------------------------------------------
+int vtkCGALMeshDeformation::FillOutputPortInformation(int, vtkInformation* info)
+{
+  // vtkPolyData or vtkMultiBlockDataSet, see RequestDataObject
+  info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkDataObject");
+  return 1;
+}
+
 //------------------------------------------------------------------------------
 void vtkCGALMeshDeformation::SetSourceConnection(vtkAlgorithmOutput* algOutput)
 {
@@ -71,60 +835,55 @@ int vtkCGALMeshDeformation::RequestData(
   vtkInformation*, vtkInformationVector** inputVector, vtkInformationVector* outputVector)
 {
   // Get the input and output data objects.
-  vtkPolyData* input   = vtkPolyData::GetData(inputVector[0]);
-  vtkPointSet* targets = vtkPointSet::GetData(inputVector[1]);
-  vtkPolyData* output  = vtkPolyData::GetData(outputVector);
+  vtkPolyData*          input       = vtkPolyData::GetData(inputVector[0]);
+  vtkDataObject*        targetsData = vtkDataObject::GetData(inputVector[1]);
+  vtkMultiBlockDataSet* batch       = vtkMultiBlockDataSet::SafeDownCast(targetsData);
+  vtkPolyData*          output      = vtkPolyData::GetData(outputVector);
+  vtkMultiBlockDataSet* batchOutput = vtkMultiBlockDataSet::GetData(outputVector);
 
-  if (!input || !targets || !output)
+  if (!input || !targetsData || (batch ? !batchOutput : !output))
   {
     vtkErrorMacro(<< "Missing input or output!");
     return 0;
   }
 
-  // Get the optional selection input
-  vtkInformation*     selInfo = inputVector[2]->GetInformationObject(0);
-  vtkNew<vtkPointSet> roi;
-
-  // If no selection is given, use control points as ROI
-  // A better approach could use all points within a radius
-  // of the control points to avoid self intersections
-  if (selInfo)
-  {
-    vtkSelection* roiSel = vtkSelection::SafeDownCast(selInfo->Get(vtkDataObject::DATA_OBJECT()));
-    vtkNew<vtkExtractSelection> extractSelection;
-    extractSelection->SetInputData(0, input);
-    extractSelection->SetInputData(1, roiSel);
-    extractSelection->Update();
-    roi->ShallowCopy(extractSelection->GetOutputDataObject(0));
-    if (!roi || roi->GetNumberOfPoints() == 0)
-    {
-      vtkErrorMacro("Not a valid selection, need points.");
-      output->ShallowCopy(input);
-      return 0;
+  // The sets of target positions, a single one unless a batch is given
+  std::vector<vtkPointSet*> targetSets;
+  if (batch)
+  {
+    vtkSmartPointer<vtkCompositeDataIterator> iter;
+    iter.TakeReference(batch->NewIterator());
+    for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem())
+    {
+      targetSets.emplace_back(vtkPointSet::SafeDownCast(iter->GetCurrentDataObject()));
+      if (!targetSets.back())
+      {
+        vtkErrorMacro(<< "The blocks of the targets must be point sets!");
+        return 0;
+      }
     }
   }
   else
   {
-    roi->ShallowCopy(targets);
+    targetSets.emplace_back(vtkPointSet::SafeDownCast(targetsData));
   }
+  if (targetSets.empty() || !targetSets.front())
+  {
+    vtkErrorMacro(<< "Missing target positions!");
+    return 0;
+  }
+  vtkPointSet* targets = targetSets.front();
 
-  // Create the triangle mesh for CGAL
-  // --------------------------------
-
-  std::unique_ptr<Vespa_surface> cgalMesh = std::make_unique<Vespa_surface>();
-  this->toCGAL(input, cgalMesh.get());
-
-  // Create the deformation object
-  // ---------------------------------
-
-  SmoothDeformation   smoothDeformer(cgalMesh->surface);
-  SRE_ARAPDeformation arapDeformer(cgalMesh->surface);
-  arapDeformer.set_sre_arap_alpha(this->SreAlpha);
+  // Get the optional selection input
+  vtkInformation* selInfo = inputVector[2]->GetInformationObject(0);
+  vtkSelection*   roiSel =
+    selInfo ? vtkSelection::SafeDownCast(selInfo->Get(vtkDataObject::DATA_OBJECT())) : nullptr;
 
   // Find global ID array name
   // ---------------------------------
 
-  if (this->GlobalIdArray.empty())
+  std::string gidName = this->GlobalIdArray;
+  if (gidName.empty())
   {
     if (!input->GetPointData()->GetGlobalIds())
     {
@@ -133,131 +892,588 @@ int vtkCGALMeshDeformation::RequestData(
            "using SetGlobalIdArray().");
       return 0;
     }
-    else
-    {
-      this->GlobalIdArray = input->GetPointData()->GetGlobalIds()->GetName();
-    }
+    gidName = input->GetPointData()->GetGlobalIds()->GetName();
   }
 
-  // Define the ROI
+  // Define the control points
   // ---------------------------------
 
-  if (!roi->GetPointData()->GetArray(this->GlobalIdArray.c_str()))
+  if (!targets->GetPointData()->GetArray(gidName.c_str()))
   {
-    vtkErrorMacro(<< "No array named " << this->GlobalIdArray << " for the ROI!");
+    vtkErrorMacro(<< "No array named " << gidName << " for the control points!");
     return 0;
   }
 
-  auto gids =
-    vtk::DataArrayValueRange<1>(roi->GetPointData()->GetArray(this->GlobalIdArray.c_str()));
-  std::vector<Graph_Verts> roiVerts(gids.cbegin(), gids.cend());
-  try
+  auto gids = vtk::DataArrayValueRange<1>(targets->GetPointData()->GetArray(gidName.c_str()));
+  std::vector<vtkIdType> ctrlIds(gids.cbegin(), gids.cend());
+
+  // the sets of a batch share the system, they must move the same points
+  for (vtkPointSet* set : targetSets)
   {
-    switch (this->Mode)
+    vtkDataArray* setGids = set->GetPointData()->GetArray(gidName.c_str());
+    if (!setGids || setGids->GetNumberOfTuples() != static_cast<vtkIdType>(ctrlIds.size()) ||
+      !std::equal(ctrlIds.begin(), ctrlIds.end(), vtk::DataArrayValueRange<1>(setGids).cbegin(),
+        [](vtkIdType id, double setId) { return id == static_cast<vtkIdType>(setId); }))
     {
-      case SRE_ARAP:
-        arapDeformer.insert_roi_vertices(roiVerts.begin(), roiVerts.end());
-        break;
-      default:
-        smoothDeformer.insert_roi_vertices(roiVerts.begin(), roiVerts.end());
-        break;
+      vtkErrorMacro(<< "All the sets of targets must have the same control points.");
+      return 0;
     }
   }
-  catch (std::exception& e)
-  {
-    vtkErrorMacro("CGAL Exception: " << e.what());
-    return 0;
-  }
 
-  // Define the control points
+  // Reuse the deformation system when only the target positions changed
   // ---------------------------------
 
-  if (!targets->GetPointData()->GetArray(this->GlobalIdArray.c_str()))
-  {
-    vtkErrorMacro(<< "No array named " << this->GlobalIdArray << " for the control points!");
-    return 0;
-  }
+  Session*   session = this->CurrentSession.get();
+  const bool reuse   = session && session->InputTime == input->GetMTime() &&
+    session->SelectionTime == (roiSel ? roiSel->GetMTime() : 0) && session->Mode == this->Mode &&
+    session->SreAlpha == this->SreAlpha && session->SolverBackend == this->SolverBackend &&
+    session->RoiRadius == this->RoiRadius && session->ProxyRatio == this->ProxyRatio &&
+    session->Local == this->LocalDeformation && session->GlobalIdArray == gidName &&
+    session->Controls == ctrlIds;
 
-  gids =
-    vtk::DataArrayValueRange<1>(targets->GetPointData()->GetArray(this->GlobalIdArray.c_str()));
-  std::vector<Graph_Verts> ctrlPoints(gids.cbegin(), gids.cend());
-  try
+  this->NumberOfLoadedFactorizations = 0;
+  this->NumberOfFactorizations       = 0;
+  if (!reuse)
   {
-    switch (this->Mode)
+    auto newSession           = std::make_unique<Session>();
+    newSession->InputTime     = input->GetMTime();
+    newSession->SelectionTime = roiSel ? roiSel->GetMTime() : 0;
+    newSession->Mode          = this->Mode;
+    newSession->SreAlpha      = this->SreAlpha;
+    newSession->SolverBackend = this->SolverBackend;
+    newSession->RoiRadius     = this->RoiRadius;
+    newSession->ProxyRatio    = this->ProxyRatio;
+    newSession->Local         = this->LocalDeformation;
+    newSession->GlobalIdArray = gidName;
+    newSession->Controls      = ctrlIds;
+
+    // Index the global IDs, once per input
+    // ---------------------------------
+
+    if (session && session->InputTime == input->GetMTime() && session->GlobalIdArray == gidName)
     {
-      case SRE_ARAP:
-        arapDeformer.insert_control_vertices(ctrlPoints.begin(), ctrlPoints.end());
-        break;
-      default:
-        smoothDeformer.insert_control_vertices(ctrlPoints.begin(), ctrlPoints.end());
-        break;
+      newSession->Index = std::move(session->Index);
     }
-  }
-  catch (std::exception& e)
-  {
-    vtkErrorMacro("CGAL Exception: " << e.what());
-    return 0;
-  }
+    else
+    {
+      StageTimer    stage(this, "index global IDs", input->GetNumberOfPoints());
+      vtkDataArray* inputGids = input->GetPointData()->GetArray(gidName.c_str());
+      if (!inputGids)
+      {
+        vtkErrorMacro(<< "No array named " << gidName << " for the mesh!");
+        return 0;
+      }
+      if (!newSession->Index.Build(inputGids))
+      {
+        vtkErrorMacro(<< "The global IDs of " << gidName << " are not unique.");
+        return 0;
+      }
+    }
+    this->CurrentSession.reset();
 
-  // Define the target positions for the control points
-  // ---------------------------------
+    // input points of the global IDs
+    std::vector<vtkIdType> unknownIds;
+    const auto             resolve = [&](std::vector<vtkIdType>& ids) {
+      for (vtkIdType& id : ids)
+      {
+        const vtkIdType pid = newSession->Index.Find(id);
+        if (pid < 0)
+        {
+          unknownIds.emplace_back(id);
+        }
+        id = pid;
+      }
+    };
 
-  for (vtkIdType ptIdx = 0; ptIdx < targets->GetNumberOfPoints(); ++ptIdx)
-  {
-    double coords[3] = { 0.0, 0.0, 0.0 };
-    targets->GetPoint(ptIdx, coords);
-    try
+    std::vector<vtkIdType> ctrlPids = ctrlIds;
+    resolve(ctrlPids);
+
+    // the proxy is decimated from the ROI submesh
+    const bool proxy = this->ProxyRatio < 1.;
+    const bool local = this->LocalDeformation || proxy;
+
+    // point to cells links, without modifying the input
+    vtkNew<vtkPolyData> linked;
+    if (local || (!roiSel && this->RoiRadius > 0.))
     {
-      switch (this->Mode)
+      StageTimer stage(this, "build links", input->GetNumberOfCells());
+      linked->CopyStructure(input);
+      linked->BuildLinks();
+    }
+
+    // Define the ROI
+    // ---------------------------------
+
+    std::vector<vtkIdType> roiIds;
+    if (roiSel)
+    {
+      StageTimer                  stage(this, "extract selection", input->GetNumberOfCells());
+      vtkNew<vtkExtractSelection> extractSelection;
+      extractSelection->SetInputData(0, input);
+      extractSelection->SetInputData(1, roiSel);
+      extractSelection->Update();
+      vtkNew<vtkPointSet> roi;
+      roi->ShallowCopy(extractSelection->GetOutputDataObject(0));
+      if (roi->GetNumberOfPoints() == 0)
       {
-        case SRE_ARAP:
+        vtkErrorMacro("Not a valid selection, need points.");
+        if (output)
         {
-          SRE_ARAPDeformation::Point targetPosARAP(coords[0], coords[1], coords[2]);
-          arapDeformer.set_target_position(ctrlPoints[ptIdx], targetPosARAP);
-          break;
+          output->ShallowCopy(input);
         }
-        default:
+        return 0;
+      }
+      if (!roi->GetPointData()->GetArray(gidName.c_str()))
+      {
+        vtkErrorMacro(<< "No array named " << gidName << " for the ROI!");
+        return 0;
+      }
+      gids = vtk::DataArrayValueRange<1>(roi->GetPointData()->GetArray(gidName.c_str()));
+      roiIds.assign(gids.cbegin(), gids.cend());
+      resolve(roiIds);
+    }
+
+    if (!unknownIds.empty())
+    {
+      vtkErrorMacro(<< unknownIds.size() << " global IDs of the ROI or control points, such as "
+                    << unknownIds.front() << ", are not in the mesh.");
+      return 0;
+    }
+
+    if (!roiSel && this->RoiRadius > 0.)
+    {
+      StageTimer stage(this, "grow ROI", ctrlPids.size());
+      roiIds = ::growRoi(linked, ctrlPids, this->RoiRadius);
+    }
+
+    // the control points always belong to the ROI
+    roiIds.insert(roiIds.end(), ctrlPids.begin(), ctrlPids.end());
+    std::sort(roiIds.begin(), roiIds.end());
+    roiIds.erase(std::unique(roiIds.begin(), roiIds.end()), roiIds.end());
+
+    // Split the ROI into independent problems
+    // ---------------------------------
+
+    // the components of the ROI more than 3 edges apart do not interact through
+    // their fixed rings, each one with control points is deformed on its own submesh
+    std::vector<int> labels(roiIds.size(), 0);
+    int              nbComponents = 1;
+    if (local)
+    {
+      StageTimer stage(this, "split ROI", roiIds.size());
+      labels = ::roiComponents(linked, roiIds, nbComponents);
+    }
+
+    std::vector<std::vector<vtkIdType>> componentRoi(nbComponents);
+    std::vector<std::vector<vtkIdType>> componentTargets(nbComponents);
+    for (std::size_t i = 0; i < roiIds.size(); i++)
+    {
+      componentRoi[labels[i]].emplace_back(roiIds[i]);
+    }
+    for (std::size_t i = 0; i < ctrlPids.size(); i++)
+    {
+      const auto it = std::lower_bound(roiIds.begin(), roiIds.end(), ctrlPids[i]);
+      componentTargets[labels[it - roiIds.begin()]].emplace_back(i);
+    }
+
+    // Create the triangle meshes for CGAL
+    // --------------------------------
+
+    for (int c = 0; c < nbComponents; c++)
+    {
+      if (componentTargets[c].empty())
+      {
+        continue; // nothing moves this component
+      }
+
+      DeformationPart part;
+      part.Mesh    = std::make_unique<Vespa_surface>();
+      part.Targets = componentTargets[c];
+
+      std::vector<vtkIdType> roiMeshIds = componentRoi[c];
+      std::vector<vtkIdType> ctrlMeshIds;
+      for (vtkIdType target : part.Targets)
+      {
+        ctrlMeshIds.emplace_back(ctrlPids[target]);
+      }
+
+      if (local)
+      {
+        vtkSmartPointer<vtkPolyData> submesh;
+        {
+          StageTimer stage(this, "extract ROI submesh", roiMeshIds.size());
+          submesh = ::extractSubmesh(linked, roiMeshIds, part.MeshToInput);
+        }
+
+        std::unordered_map<vtkIdType, vtkIdType> inputToMesh;
+        for (std::size_t i = 0; i < part.MeshToInput.size(); i++)
+        {
+          inputToMesh.emplace(part.MeshToInput[i], static_cast<vtkIdType>(i));
+        }
+        for (vtkIdType& pid : roiMeshIds)
+        {
+          pid = inputToMesh.count(pid) ? inputToMesh[pid] : -1;
+        }
+        for (vtkIdType& pid : ctrlMeshIds)
         {
-          SmoothDeformation::Point targetPosSmooth(coords[0], coords[1], coords[2]);
-          smoothDeformer.set_target_position(ctrlPoints[ptIdx], targetPosSmooth);
-          break;
+          pid = inputToMesh.count(pid) ? inputToMesh[pid] : -1;
         }
+        if (std::count(ctrlMeshIds.begin(), ctrlMeshIds.end(), -1) > 0)
+        {
+          vtkErrorMacro("Some control points do not belong to any polygon.");
+          return 0;
+        }
+        roiMeshIds.erase(std::remove(roiMeshIds.begin(), roiMeshIds.end(), -1), roiMeshIds.end());
+
+        this->toCGAL(submesh, part.Mesh.get());
       }
+      else
+      {
+        this->toCGAL(input, part.Mesh.get());
+      }
+
+      for (vtkIdType pid : roiMeshIds)
+      {
+        part.Roi.emplace_back(static_cast<Graph_Verts::size_type>(pid));
+      }
+      for (vtkIdType pid : ctrlMeshIds)
+      {
+        part.Handles.emplace_back(static_cast<Graph_Verts::size_type>(pid));
+      }
+      newSession->Parts.emplace_back(std::move(part));
     }
-    catch (std::exception& e)
+
+    std::vector<DeformationPart>& parts = newSession->Parts;
+    const vtkIdType               nbParts = static_cast<vtkIdType>(parts.size());
+    std::vector<std::string>      errors(parts.size());
+    const auto                    reportErrors = [&]() {
+      for (const std::string& error : errors)
+      {
+        if (!error.empty())
+        {
+          vtkErrorMacro(<< error);
+          return true;
+        }
+      }
+      return false;
+    };
+
+    // Decimate the ROI into the proxies to deform
+    // ---------------------------------
+
+    if (proxy)
     {
-      vtkErrorMacro("CGAL Exception: " << e.what());
-      return 0;
+      StageTimer stage(this, "decimate proxy", roiIds.size());
+      vtkSMPTools::For(0, nbParts, 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+        {
+          try
+          {
+            ::makeProxy(parts[i], input, this->ProxyRatio);
+          }
+          catch (std::exception& e)
+          {
+            errors[i] = std::string("CGAL Exception: ") + e.what();
+          }
+        }
+      });
+      if (reportErrors())
+      {
+        return 0;
+      }
+    }
+
+    // Create the deformation objects and factorize their systems, in parallel
+    // ---------------------------------
+
+    std::size_t nbRoi = 0;
+    for (const DeformationPart& part : parts)
+    {
+      nbRoi += part.Roi.size();
     }
+
+    {
+      StageTimer        stage(this, "preprocess", nbRoi);
+      const bool        cached = !this->FactorizationCacheDirectory.empty();
+      std::vector<char> loaded(parts.size(), 0), stored(parts.size(), 0);
+      std::vector<unsigned int> factorized(parts.size(), 0);
+      vtkSMPTools::For(0, nbParts, 1, [&](vtkIdType begin, vtkIdType end) {
+        for (vtkIdType i = begin; i < end; i++)
+        {
+          DeformationPart&                  part = parts[i];
+          Vespa_cached_direct_solver::Scope cache(
+            this->FactorizationCacheDirectory, &newSession->Memory);
+          try
+          {
+            part.Deformer = ::makeDeformer(this, part.Mesh->surface);
+            if (!part.Deformer->Prepare(part.Roi, part.Handles))
+            {
+              errors[i] = "The deformation system of the ROI could not be factorized.";
+            }
+          }
+          catch (std::exception& e)
+          {
+            errors[i] = std::string("CGAL Exception: ") + e.what();
+          }
+          loaded[i]     = cache.Loaded;
+          stored[i]     = cache.Loaded || cache.Shared || cache.Saved;
+          factorized[i] = cache.Factorizations;
+        }
+      });
+      if (reportErrors())
+      {
+        return 0;
+      }
+
+      this->NumberOfLoadedFactorizations =
+        static_cast<unsigned int>(std::count(loaded.begin(), loaded.end(), 1));
+      this->NumberOfFactorizations = std::accumulate(factorized.begin(), factorized.end(), 0u);
+      if (this->NumberOfLoadedFactorizations > 0)
+      {
+        vtkDebugMacro(<< this->NumberOfLoadedFactorizations << " factorizations read from "
+                      << this->FactorizationCacheDirectory);
+      }
+      if (cached && this->SolverBackend == vtkCGALPolyDataAlgorithm::DIRECT_SOLVER &&
+        std::count(stored.begin(), stored.end(), 0) > 0)
+      {
+        vtkWarningMacro("Could not store the factorization in "
+          << this->FactorizationCacheDirectory);
+      }
+    }
+
+    this->CurrentSession = std::move(newSession);
+    session              = this->CurrentSession.get();
+  }
+
+  std::size_t nbRoi = 0, nbProxyRoi = 0;
+  for (const DeformationPart& part : session->Parts)
+  {
+    nbRoi += part.Roi.size();
+    nbProxyRoi += part.Proxy.size();
+  }
+  std::vector<DeformationPart>& parts = session->Parts;
+
+  // each set of a batch is deformed from the rest shape, into its own output
+  if (batch)
+  {
+    return this->DeformBatch(input, targetSets, batch, batchOutput) ? 1 : 0;
   }
 
   // CGAL Processing
   // ---------------
 
-  try
+  // only the ROI moves: its points are updated in a copy of the input,
+  // the cells and the attributes are shared
+  vtkNew<vtkPoints> points;
+  points->DeepCopy(input->GetPoints());
+
   {
-    // Deform mesh given ROI and control point targets
-    switch (this->Mode)
+    StageTimer stage(this, "deform", nbRoi);
+
+    // Run the parts in parallel and each of their steps below in turn
+    std::vector<std::string>  errors(parts.size());
+    std::vector<unsigned int> factorized(parts.size(), 0);
+    const auto                forParts = [&](const std::function<void(vtkIdType)>& step) {
+      vtkSMPTools::For(0, static_cast<vtkIdType>(parts.size()), 1,
+        [&](vtkIdType begin, vtkIdType end) {
+          for (vtkIdType i = begin; i < end; i++)
+          {
+            // the systems are only factorized again if CGAL preprocesses again
+            Vespa_cached_direct_solver::Scope cache(
+              this->FactorizationCacheDirectory, &session->Memory);
+            try
+            {
+              step(i);
+            }
+            catch (std::exception& e)
+            {
+              errors[i] = e.what();
+            }
+            factorized[i] += cache.Factorizations;
+          }
+        });
+
+      for (const std::string& error : errors)
+      {
+        if (!error.empty())
+        {
+          vtkErrorMacro("CGAL Exception: " << error);
+          return false;
+        }
+      }
+      return true;
+    };
+
+    // Move the control points to their targets. A reused session iterates from
+    // the previous result, whose rotations are a warm start for the new targets:
+    // resetting the deformers to the rest shape would preprocess their systems again.
+    if (!forParts([&](vtkIdType i) {
+          parts[i].Deformer->SetTargets(parts[i].Handles, parts[i].Targets, targets);
+        }))
     {
-      case SRE_ARAP:
-        arapDeformer.deform(this->NumberOfIterations, this->Tolerance);
-        break;
-      default:
-        smoothDeformer.deform(this->NumberOfIterations, this->Tolerance);
+      return 0;
+    }
+
+    // Iterate until every part converged, reporting the progress after each
+    // iteration. After an abort, the output is the last iteration.
+    std::vector<double> changes(parts.size(), VTK_DOUBLE_MAX);
+    this->Iteration       = 0;
+    this->IterationChange = 0.;
+    for (unsigned int it = 0; it < this->NumberOfIterations && !this->GetAbortExecute(); it++)
+    {
+      if (!forParts([&](vtkIdType i) {
+            if (changes[i] >= this->Tolerance)
+            {
+              changes[i] = parts[i].Deformer->Iterate();
+            }
+          }))
+      {
+        return 0;
+      }
+
+      this->Iteration       = it + 1;
+      this->IterationChange = 0.;
+      for (double change : changes)
+      {
+        this->IterationChange = std::max(this->IterationChange, change);
+      }
+      if (this->IntermediateResults)
+      {
+        for (const DeformationPart& part : parts)
+        {
+          ::writeDeformedRoi(part, part.Mesh->surface, input, points);
+        }
+        points->Modified();
+        output->CopyStructure(input);
+        output->SetPoints(points);
+      }
+      this->UpdateProgress(static_cast<double>(this->Iteration) / this->NumberOfIterations);
+
+      if (this->IterationChange < this->Tolerance)
+      {
         break;
+      }
     }
-  }
-  catch (std::exception& e)
-  {
-    vtkErrorMacro("CGAL Exception: " << e.what());
-    return 0;
+    this->NumberOfFactorizations += std::accumulate(factorized.begin(), factorized.end(), 0u);
   }
 
   // VTK Output
   // ----------
 
-  this->toVTK(cgalMesh.get(), output);
+  StageTimer stage(this, "output", nbProxyRoi > 0 ? nbProxyRoi : nbRoi);
+  for (const DeformationPart& part : parts)
+  {
+    ::writeDeformedRoi(part, part.Mesh->surface, input, points);
+  }
+
+  output->CopyStructure(input);
+  output->SetPoints(points);
   this->copyAttributes(input, output);
 
   return 1;
 }
+
+//------------------------------------------------------------------------------
+bool vtkCGALMeshDeformation::DeformBatch(vtkPolyData* input,
+  const std::vector<vtkPointSet*>& targetSets, vtkMultiBlockDataSet* batch,
+  vtkMultiBlockDataSet* output)
+{
+  Session*                      session = this->CurrentSession.get();
+  std::vector<DeformationPart>& parts   = session->Parts;
+  const vtkIdType               nbSets  = static_cast<vtkIdType>(targetSets.size());
+  const vtkIdType               nbWorkers =
+    std::min<vtkIdType>(nbSets, std::max(1, vtkSMPTools::GetEstimatedNumberOfThreads()));
+
+  std::size_t nbRoi = 0;
+  for (const DeformationPart& part : parts)
+  {
+    nbRoi += part.Roi.size();
+  }
+
+  std::vector<vtkSmartPointer<vtkPoints>> setPoints(targetSets.size());
+  {
+    StageTimer stage(this, "deform batch", nbRoi * targetSets.size());
+
+    // Each worker deforms every nbWorkers-th set on its own copy of the parts,
+    // from the rest shape, leaving the session at its last result. The copies
+    // build the systems of the parts, whose factorizations are shared.
+    std::vector<std::string>  errors(nbWorkers);
+    std::vector<unsigned int> factorized(nbWorkers, 0);
+    vtkSMPTools::For(0, nbWorkers, 1, [&](vtkIdType begin, vtkIdType end) {
+      for (vtkIdType w = begin; w < end; w++)
+      {
+        Vespa_cached_direct_solver::Scope cache(
+          this->FactorizationCacheDirectory, &session->Memory);
+        try
+        {
+          // the deformers are declared last as they keep a reference on the meshes
+          std::vector<std::unique_ptr<CGAL_Surface>> meshes;
+          std::vector<std::unique_ptr<DeformerBase>> deformers;
+          for (const DeformationPart& part : parts)
+          {
+            meshes.emplace_back(std::make_unique<CGAL_Surface>(part.Mesh->surface));
+            ::restoreRoi(part, *meshes.back(), input);
+            deformers.emplace_back(::makeDeformer(this, *meshes.back()));
+            if (!deformers.back()->Prepare(part.Roi, part.Handles))
+            {
+              errors[w] = "The deformation system of the ROI could not be factorized.";
+              break;
+            }
+          }
+
+          for (vtkIdType set = w; set < nbSets && errors[w].empty(); set += nbWorkers)
+          {
+            setPoints[set] = vtkSmartPointer<vtkPoints>::New();
+            setPoints[set]->DeepCopy(input->GetPoints());
+            for (std::size_t i = 0; i < parts.size(); i++)
+            {
+              if (set != w)
+              {
+                deformers[i]->Reset();
+              }
+              deformers[i]->Deform(parts[i].Handles, parts[i].Targets, targetSets[set],
+                this->NumberOfIterations, this->Tolerance);
+              ::writeDeformedRoi(parts[i], *meshes[i], input, setPoints[set]);
+            }
+          }
+        }
+        catch (std::exception& e)
+        {
+          errors[w] = std::string("CGAL Exception: ") + e.what();
+        }
+        factorized[w] = cache.Factorizations;
+      }
+    });
+
+    for (const std::string& error : errors)
+    {
+      if (!error.empty())
+      {
+        vtkErrorMacro(<< error);
+        return false;
+      }
+    }
+    this->NumberOfFactorizations += std::accumulate(factorized.begin(), factorized.end(), 0u);
+  }
+
+  // VTK Output
+  // ----------
+
+  // one deformed mesh per set of targets, in the structure of the batch
+  StageTimer stage(this, "output", input->GetNumberOfPoints() * nbSets);
+  output->CopyStructure(batch);
+
+  vtkSmartPointer<vtkCompositeDataIterator> iter;
+  iter.TakeReference(batch->NewIterator());
+  vtkIdType set = 0;
+  for (iter->InitTraversal(); !iter->IsDoneWithTraversal(); iter->GoToNextItem(), set++)
+  {
+    vtkNew<vtkPolyData> block;
+    block->CopyStructure(input);
+    block->SetPoints(setPoints[set]);
+    this->copyAttributes(input, block);
+    output->SetDataSet(iter, block);
+  }
+
+  return true;
+}
@@ -11,9 +11,56 @@
  *   - a vtkPointSet with the target positions of the control points, identified by their IDs
  *   - a vtkSelection corresponding to the ROI (optional)
  *
- * If a ROI is not specified, it is defined with the control points.
- * In this case, the control points will simply be moved to their destinations without
+ * If a ROI is not specified, it is grown from the control points up to the RoiRadius,
+ * measured along the mesh edges. If the RoiRadius is 0, the ROI is defined with the
+ * control points: these will simply be moved to their destinations without
  * modifying the rest of the mesh.
+ *
+ * With LocalDeformation, only the cells around the ROI and around its 1-ring are
+ * converted to CGAL, so that the cost scales with the size of the ROI rather than
+ * the mesh. These cells hold every edge the deformation energy of the ROI uses.
+ * The ROI is split into components more than 3 edges apart, whose fixed rings
+ * neither touch nor share an edge: the regions closer than that interact and are
+ * merged. Each component is then an independent deformation problem, with its own
+ * submesh and system: the components are factorized and deformed in parallel,
+ * which makes editing several distant regions at once scale with the number of
+ * cores. The components without control points are left unchanged.
+ *
+ * With a ProxyRatio below 1, which implies a local deformation, each ROI submesh
+ * is first decimated into a coarser proxy, keeping the control points and the
+ * fixed points around the ROI. The proxy is deformed, then each point of the ROI
+ * follows the displacement of its closest proxy triangle, using barycentric
+ * coordinates computed once. The cost of the solver then depends on the proxy
+ * size rather than the mesh resolution.
+ *
+ * The deformation system of the ROI is kept between executions: as long as the
+ * mesh, the ROI, the control point IDs and the deformation parameters are unchanged
+ * (based on their MTime), an update only moves the control points to their new
+ * target positions and solves the already factorized system, with any
+ * SolverBackend. The iterations start from the previous result, which is close
+ * to the new one while the control points are dragged, so they converge in a
+ * few steps to the same shape as a deformation from the rest shape. Until it
+ * converges, the output also depends on the previous targets.
+ * This makes dragging the control points interactive.
+ *
+ * The iterations are run one at a time on all the parts. After each one, a
+ * ProgressEvent is fired, the filter stops if AbortExecute is set, and with
+ * IntermediateResults the output already holds the current shape, so that a
+ * large deformation can be watched while it converges or be interrupted.
+ *
+ * With a FactorizationCacheDirectory, the factorized systems are also stored on
+ * disk, named after a hash of the system, i.e. of the mesh around the ROI, the ROI
+ * and the control points. Reopening the same case in a later session reads the
+ * factorization instead of computing it again.
+ *
+ * The second input may also be a vtkMultiBlockDataSet of point sets with the same
+ * control points, e.g. the time steps of an animation or the candidates of a
+ * parameter study. Each set of targets deforms the mesh from its rest shape into
+ * the matching block of a vtkMultiBlockDataSet output. The sets are shared among
+ * threads, each one deforming its own copy of the ROI. The copy starts again from
+ * the rest shape for each set, which builds its system again: with the
+ * DIRECT_SOLVER, the factorization is shared in memory, the other backends
+ * factorize it again.
  */
 
 #ifndef vtkCGALMeshDeformation_h
@@ -23,6 +70,12 @@
 
 #include "vtkCGALPMPModule.h" // For export macro
 
+#include <memory> // For std::unique_ptr
+#include <vector> // For DeformBatch
+
+class vtkMultiBlockDataSet;
+class vtkPointSet;
+
 class VTKCGALPMP_EXPORT vtkCGALMeshDeformation : public vtkCGALPolyDataAlgorithm
 {
 public:
@@ -42,7 +95,7 @@ public:
   };
 
   /**
-   * Set input connection for the second input (vtkPointSet).
+   * Set input connection for the second input (vtkPointSet or vtkMultiBlockDataSet).
    **/
   void SetSourceConnection(vtkAlgorithmOutput* algOutput);
 
@@ -80,34 +133,153 @@ public:
 
   ///@{
   /**
-   * Get/set the tolerance of the energy convergence used in the deformation process.
-   * Default is 1e-4.
+   * Get/set the tolerance of the convergence used in the deformation process: the
+   * iterations stop when the ROI moves less than this fraction of its displacement
+   * during one iteration. This is measured on the positions, not on the energy.
+   * If 0, all the iterations are run.
+   * Default is 1e-3.
    **/
   vtkGetMacro(Tolerance, double);
   vtkSetMacro(Tolerance, double);
   ///@}
 
+  ///@{
+  /**
+   * Get/set whether the output points are updated after each iteration, before
+   * the ProgressEvent, so that its observers can show the deformation converging.
+   * Default is false.
+   **/
+  vtkGetMacro(IntermediateResults, bool);
+  vtkSetMacro(IntermediateResults, bool);
+  vtkBooleanMacro(IntermediateResults, bool);
+  ///@}
+
+  ///@{
+  /**
+   * Get the number of iterations run by the last deformation, and how much the
+   * ROI moved during the last one, relative to its displacement.
+   * Meant for the observers of the ProgressEvent.
+   **/
+  vtkGetMacro(Iteration, unsigned int);
+  vtkGetMacro(IterationChange, double);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the radius of the ROI grown around the control points when no
+   * selection is given. The distance is the shortest path along the mesh edges.
+   * If 0, the ROI is made of the control points only.
+   * Default is 0.
+   **/
+  vtkGetMacro(RoiRadius, double);
+  vtkSetClampMacro(RoiRadius, double, 0., VTK_DOUBLE_MAX);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set whether only the cells around the ROI and its 1-ring are deformed.
+   * The other points of these cells are fixed, and the rotations of the 1-ring
+   * see all their neighbors, so the result is the same as when deforming the
+   * whole mesh, for a cost that depends on the ROI size only.
+   * Default is false.
+   **/
+  vtkGetMacro(LocalDeformation, bool);
+  vtkSetMacro(LocalDeformation, bool);
+  vtkBooleanMacro(LocalDeformation, bool);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the ratio of ROI edges kept in the proxy that is deformed instead of
+   * the ROI. Lower ratios are faster but smooth out the details of the
+   * deformation between the control points. 1 deforms the ROI itself.
+   * Default is 1.
+   **/
+  vtkGetMacro(ProxyRatio, double);
+  vtkSetClampMacro(ProxyRatio, double, 0.01, 1.);
+  ///@}
+
   ///@{
   /**
    * Get/set the name of the array containing the IDs to use when defining ROI and control points.
+   * The IDs must be unique but do not need to match the point indices, so that
+   * cropped, merged or partitioned meshes can be deformed without renumbering.
    * Default is the array returned by GetGlobalIds for the points.
    **/
   vtkGetMacro(GlobalIdArray, std::string);
   vtkSetMacro(GlobalIdArray, std::string);
   ///@}
 
+  ///@{
+  /**
+   * Get/set the directory where the factorized deformation systems are stored
+   * and looked up. The files are only used with the DIRECT_SOLVER backend and
+   * are only valid for the Eigen version that wrote them; others are ignored
+   * and replaced. If empty, nothing is stored.
+   * Default is empty.
+   **/
+  vtkGetMacro(FactorizationCacheDirectory, std::string);
+  vtkSetMacro(FactorizationCacheDirectory, std::string);
+  ///@}
+
+  /**
+   * Get the number of factorized systems read from the FactorizationCacheDirectory
+   * by the last execution, 0 if it reused its system or computed them.
+   **/
+  vtkGetMacro(NumberOfLoadedFactorizations, unsigned int);
+
+  /**
+   * Get the number of systems factorized by the last execution, 0 if it reused
+   * its system or found all the factorizations in memory or on disk.
+   **/
+  vtkGetMacro(NumberOfFactorizations, unsigned int);
+
+  /**
+   * Release the deformation system kept between executions.
+   * The next execution will build it again.
+   **/
+  void ReleaseSession();
+
+  /**
+   * Create a vtkMultiBlockDataSet output for a batch of targets, a vtkPolyData otherwise.
+   */
+  vtkTypeBool ProcessRequest(
+    vtkInformation* request, vtkInformationVector** inInfo, vtkInformationVector* outInfo) override;
+
 protected:
   vtkCGALMeshDeformation();
-  ~vtkCGALMeshDeformation() override = default;
+  ~vtkCGALMeshDeformation() override;
 
+  int RequestDataObject(vtkInformation*, vtkInformationVector**, vtkInformationVector*);
   int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
   int FillInputPortInformation(int port, vtkInformation* info) override;
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
+
+  /**
+   * Deform the mesh of the current session for each set of targets of the
+   * batch, into the matching block of the output.
+   */
+  bool DeformBatch(vtkPolyData* input, const std::vector<vtkPointSet*>& targetSets,
+    vtkMultiBlockDataSet* batch, vtkMultiBlockDataSet* output);
+
+  int          Mode                         = vtkCGALMeshDeformation::SMOOTH;
+  double       SreAlpha                     = 0.02;
+  unsigned int NumberOfIterations           = 5;
+  double       Tolerance                    = 1e-3;
+  bool         IntermediateResults          = false;
+  unsigned int Iteration                    = 0;
+  double       IterationChange              = 0.;
+  double       RoiRadius                    = 0.;
+  bool         LocalDeformation             = false;
+  double       ProxyRatio                   = 1.;
+  std::string  GlobalIdArray                = "";
+  std::string  FactorizationCacheDirectory  = "";
+  unsigned int NumberOfLoadedFactorizations = 0;
+  unsigned int NumberOfFactorizations       = 0;
 
-  int          Mode               = vtkCGALMeshDeformation::SMOOTH;
-  double       SreAlpha           = 0.02;
-  unsigned int NumberOfIterations = 5;
-  double       Tolerance          = 1e-4;
-  std::string  GlobalIdArray      = "";
+  // Mesh and deformation system reused between executions
+  struct Session;
+  std::unique_ptr<Session> CurrentSession;
 
 private:
   vtkCGALMeshDeformation(const vtkCGALMeshDeformation&) = delete;
@@ -51,6 +51,7 @@ int vtkCGALMeshSmoothing::RequestData(
 
   try
   {
+    StageTimer stage(this, "smoothing", num_faces(cgalMesh->surface));
     vtkLog(INFO, "Smoothing mesh... (" << this->NumberOfIterations << " iterations)");
 
     if (this->SmoothingMethod == 1)
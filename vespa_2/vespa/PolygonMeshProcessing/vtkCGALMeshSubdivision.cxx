@@ -68,6 +68,7 @@ int vtkCGALMeshSubdivision::RequestData(
 
   try
   {
+    StageTimer stage(this, "subdivision", num_faces(cgalMesh->surface));
     switch (this->SubdivisionType)
     {
       case vtkCGALMeshSubdivision::CATMULL_CLARK:
@@ -101,8 +102,9 @@ int vtkCGALMeshSubdivision::RequestData(
   // ----------
 
   this->toVTK(cgalMesh.get(), output);
+  this->interpolateAttributes(input, cgalMesh.get(), output);
 
-  // Triangulate if needed
+  // Triangulate if needed, attributes are passed to the triangles
   if (this->SubdivisionType == vtkCGALMeshSubdivision::CATMULL_CLARK ||
     this->SubdivisionType == vtkCGALMeshSubdivision::DOO_SABIN)
   {
@@ -112,7 +114,5 @@ int vtkCGALMeshSubdivision::RequestData(
     output->ShallowCopy(triangulator->GetOutput());
   }
 
-  this->interpolateAttributes(input, output);
-
   return 1;
 }
@@ -1,4 +1,5 @@
 #include "vtkCGALPatchFilling.h"
+#include "vtkCGALSparseSolvers.h"
 
 // VTK related includes
 #include "vtkDataSetSurfaceFilter.h"
@@ -32,13 +33,6 @@ void vtkCGALPatchFilling::PrintSelf(ostream& os, vtkIndent indent)
   this->Superclass::PrintSelf(os, indent);
 }
 
-//------------------------------------------------------------------------------
-void vtkCGALPatchFilling::SetUpdateAttributes(bool vtkNotUsed(update))
-{
-  vtkWarningMacro(
-    "Unsupported: No attributes are interpolated with the vtkCGALPatchFilling filter.");
-}
-
 //------------------------------------------------------------------------------
 int vtkCGALPatchFilling::FillInputPortInformation(int port, vtkInformation* info)
 {
@@ -80,6 +74,8 @@ int vtkCGALPatchFilling::RequestData(
   vtkInformation* selInfo = inputVector[1]->GetInformationObject(0);
   if (selInfo)
   {
+    StageTimer stage(this, "remove selection", input->GetNumberOfCells());
+
     vtkSelection* inputSel = vtkSelection::SafeDownCast(selInfo->Get(vtkDataObject::DATA_OBJECT()));
     const auto    selNbNodes = inputSel->GetNumberOfNodes();
     if (selNbNodes > 0)
@@ -117,17 +113,22 @@ int vtkCGALPatchFilling::RequestData(
 
   try
   {
+    StageTimer stage(this, "triangulate_refine_and_fair_hole", num_faces(cgalMesh->surface));
+
     // collect one halfedge per boundary cycle
     std::vector<Graph_halfedge> borderCycles;
     pmp::extract_boundary_cycles(cgalMesh->surface, std::back_inserter(borderCycles));
 
     // fill boundary cycles
-    for (Graph_halfedge h : borderCycles)
-    {
-      success &= std::get<0>(pmp::triangulate_refine_and_fair_hole(cgalMesh->surface, h,
-        std::back_inserter(patch_facets), std::back_inserter(patch_vertices),
-        pmp::parameters::fairing_continuity(this->FairingContinuity)));
-    }
+    vtkCGALWithSolver(this, [&](auto solver) {
+      for (Graph_halfedge h : borderCycles)
+      {
+        success &= std::get<0>(pmp::triangulate_refine_and_fair_hole(cgalMesh->surface, h,
+          std::back_inserter(patch_facets), std::back_inserter(patch_vertices),
+          pmp::parameters::fairing_continuity(this->FairingContinuity)
+            .sparse_linear_solver(solver)));
+      }
+    });
   }
   catch (std::exception& e)
   {
@@ -140,8 +141,9 @@ int vtkCGALPatchFilling::RequestData(
 
   this->toVTK(cgalMesh.get(), output);
 
-  // Note, there is not UpdateAttributes here as the new mesh
-  // contains patches not present in the initial surface
+  // The patches are not present in the initial surface,
+  // their attributes are extended from the hole borders
+  this->interpolateAttributes(baseDataSet, cgalMesh.get(), output);
 
   return success;
 }
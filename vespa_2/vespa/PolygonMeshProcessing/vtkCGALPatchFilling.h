@@ -9,6 +9,7 @@
  * triangulate_refine_and_fair_hole method.  This filter may also be used to
  * fill tunnels by selection the inner cells. Contrary to the vtkCGALIsotropicRemesh,
  * it won't keep the initial shape.
+ * Attributes of the patches are extended from the border of the holes.
  */
 
 #ifndef vtkCGALPatchFilling_h
@@ -25,8 +26,6 @@ public:
   vtkTypeMacro(vtkCGALPatchFilling, vtkCGALPolyDataAlgorithm);
   void PrintSelf(ostream& os, vtkIndent indent) override;
 
-  void SetUpdateAttributes(bool update) override;
-
   /**
    * Specify the selection describing the hole or patch to fill.
    */
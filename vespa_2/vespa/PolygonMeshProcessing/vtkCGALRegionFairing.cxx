@@ -1,4 +1,5 @@
 #include "vtkCGALRegionFairing.h"
+#include "vtkCGALSparseSolvers.h"
 
 // VTK related includes
 #include "vtkExtractSelection.h"
@@ -70,7 +71,10 @@ int vtkCGALRegionFairing::RequestData(
   vtkNew<vtkExtractSelection> extractSelection;
   extractSelection->SetInputData(0, input);
   extractSelection->SetInputData(1, inputSel);
-  extractSelection->Update();
+  {
+    StageTimer stage(this, "extract selection", input->GetNumberOfCells());
+    extractSelection->Update();
+  }
   vtkPointSet* dataSel = vtkPointSet::SafeDownCast(extractSelection->GetOutputDataObject(0));
   if (!dataSel || dataSel->GetNumberOfPoints() == 0)
   {
@@ -95,8 +99,12 @@ int vtkCGALRegionFairing::RequestData(
 
   try
   {
+    StageTimer stage(this, "fair", sel.size());
+
     // fair selected area
-    pmp::fair(cgalMesh->surface, sel);
+    vtkCGALWithSolver(this, [&](auto solver) {
+      pmp::fair(cgalMesh->surface, sel, pmp::parameters::sparse_linear_solver(solver));
+    });
   }
   catch (std::exception& e)
   {
@@ -108,7 +116,7 @@ int vtkCGALRegionFairing::RequestData(
   // ----------
 
   this->toVTK(cgalMesh.get(), output);
-  this->interpolateAttributes(input, output);
+  this->interpolateAttributes(input, cgalMesh.get(), output);
 
   return 1;
 }
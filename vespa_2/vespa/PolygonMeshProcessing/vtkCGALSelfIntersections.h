@@ -0,0 +1,60 @@
+/**
+ * Self intersection tests of the mesh checks and diagnostics.
+ *
+ * When VESPA is built with TBB (VESPA_USE_TBB), they run the parallel
+ * CGAL algorithms on vtkCGALPolyDataAlgorithm::NumberOfThreads threads,
+ * and sequentially otherwise.
+ */
+
+#ifndef vtkCGALSelfIntersections_h
+#define vtkCGALSelfIntersections_h
+
+#include "vtkCGALPolyDataAlgorithm.h"
+
+// CGAL related includes
+#include <CGAL/Polygon_mesh_processing/self_intersections.h>
+#include <CGAL/tags.h>
+
+#ifdef VESPA_USE_TBB
+#include <tbb/task_arena.h>
+#endif
+
+//------------------------------------------------------------------------------
+// Call functor with the concurrency tag of the CGAL algorithms,
+// within the number of threads of self.
+template <class Functor>
+void vtkCGALWithConcurrency(vtkCGALPolyDataAlgorithm* self, Functor&& functor)
+{
+#ifdef VESPA_USE_TBB
+  const int       nbThreads = self->GetNumberOfThreads();
+  tbb::task_arena arena(nbThreads > 0 ? nbThreads : tbb::task_arena::automatic);
+  arena.execute([&] { functor(CGAL::Parallel_tag()); });
+#else
+  (void)self;
+  functor(CGAL::Sequential_tag());
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Whether two faces of the mesh intersect
+template <class Mesh>
+bool vtkCGALDoesSelfIntersect(vtkCGALPolyDataAlgorithm* self, const Mesh& mesh)
+{
+  bool intersect = false;
+  vtkCGALWithConcurrency(self, [&](auto tag) {
+    intersect = CGAL::Polygon_mesh_processing::does_self_intersect<decltype(tag)>(mesh);
+  });
+  return intersect;
+}
+
+//------------------------------------------------------------------------------
+// Write the pairs of intersecting faces of the mesh to out
+template <class Mesh, class OutputIterator>
+void vtkCGALSelfIntersections(vtkCGALPolyDataAlgorithm* self, const Mesh& mesh, OutputIterator out)
+{
+  vtkCGALWithConcurrency(self, [&](auto tag) {
+    CGAL::Polygon_mesh_processing::self_intersections<decltype(tag)>(mesh, out);
+  });
+}
+
+#endif
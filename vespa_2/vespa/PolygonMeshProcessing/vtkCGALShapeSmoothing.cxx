@@ -44,6 +44,7 @@ int vtkCGALShapeSmoothing::RequestData(
 
   try
   {
+    StageTimer stage(this, "smooth_shape", num_faces(cgalMesh->surface));
     pmp::smooth_shape(cgalMesh->surface, this->TimeStep,
       pmp::parameters::number_of_iterations(this->NumberOfIterations));
   }
@@ -0,0 +1,509 @@
+/**
+ * Sparse linear solvers for the CGAL functions solving linear systems
+ * (deformation, fairing, hole filling), selected with
+ * vtkCGALPolyDataAlgorithm::SolverBackend.
+ *
+ * The parallel direct solver is Pardiso, available when VESPA is built
+ * with Intel MKL.
+ *
+ * Vespa_cached_direct_solver is the direct solver, sharing its factorizations
+ * in memory or storing them in a directory, so that the same system is only
+ * factorized once across deformers and sessions. Vespa_counted_solver counts
+ * the factorizations of the other backends.
+ */
+
+#ifndef vtkCGALSparseSolvers_h
+#define vtkCGALSparseSolvers_h
+
+#include "vtkCGALPolyDataAlgorithm.h"
+
+// CGAL related includes
+#include <CGAL/Eigen_solver_traits.h>
+
+// Eigen related includes
+#include <Eigen/SparseCore>
+#include <Eigen/IterativeLinearSolvers>
+#include <Eigen/SparseLU>
+#ifdef VESPA_USE_PARDISO
+#include <Eigen/PardisoSupport>
+#endif
+
+using Vespa_sparse_matrix = CGAL::Eigen_sparse_matrix<double>::EigenType;
+
+// single thread supernodal LU, the CGAL default
+using Vespa_direct_solver =
+  CGAL::Eigen_solver_traits<Eigen::SparseLU<Vespa_sparse_matrix, Eigen::COLAMDOrdering<int>>>;
+
+// the systems are not symmetric: BiCGSTAB, with a diagonal preconditioner to save memory
+using Vespa_iterative_solver = CGAL::Eigen_solver_traits<
+  Eigen::BiCGSTAB<Vespa_sparse_matrix, Eigen::DiagonalPreconditioner<double>>>;
+
+#ifdef VESPA_USE_PARDISO
+using Vespa_parallel_direct_solver =
+  CGAL::Eigen_solver_traits<Eigen::PardisoLU<Vespa_sparse_matrix>>;
+#endif
+
+// STL related includes
+#include <algorithm>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// SparseLU whose factors can be written to and read from a binary stream.
+// The factors are the supernodal storage of Eigen, so the files are only valid
+// for the Eigen version that wrote them.
+class Vespa_serializable_lu
+  : public Eigen::SparseLU<Vespa_sparse_matrix, Eigen::COLAMDOrdering<int>>
+{
+public:
+  // Write the factors of the system, identified by its key
+  bool Write(std::ostream& os, std::uint64_t key) const
+  {
+    const Eigen::Index n = this->cols();
+    os.write(Vespa_serializable_lu::Magic(), Vespa_serializable_lu::MagicSize);
+    Vespa_serializable_lu::WriteValue(os, Vespa_serializable_lu::Header());
+    Vespa_serializable_lu::WriteValue(os, key);
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(n));
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(this->m_nnzL));
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(this->m_nnzU));
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(this->m_detPermR));
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(this->m_detPermC));
+    Vespa_serializable_lu::WriteVector(os, this->m_perm_r.indices(), n);
+    Vespa_serializable_lu::WriteVector(os, this->m_perm_c.indices(), n);
+
+    // the factorization buffers are larger than the factors
+    const auto& glu = this->m_glu;
+    Vespa_serializable_lu::WriteVector(os, glu.xsup, n + 1);
+    Vespa_serializable_lu::WriteVector(os, glu.supno, n + 1);
+    Vespa_serializable_lu::WriteVector(os, glu.xlsub, n + 1);
+    Vespa_serializable_lu::WriteVector(os, glu.lsub, glu.xlsub(n));
+    Vespa_serializable_lu::WriteVector(os, glu.xlusup, n + 1);
+    Vespa_serializable_lu::WriteVector(os, glu.lusup, glu.xlusup(n));
+    Vespa_serializable_lu::WriteVector(os, glu.xusub, n + 1);
+    Vespa_serializable_lu::WriteVector(os, glu.usub, glu.xusub(n));
+    Vespa_serializable_lu::WriteVector(os, glu.ucol, glu.xusub(n));
+    return os.good();
+  }
+
+  // Read the factors of a n x n system identified by key, written by the same
+  // Eigen version. Return false if the stream holds another system, or factors
+  // whose permutations, indices or pointers do not fit the system.
+  bool Read(std::istream& is, std::uint64_t key, Eigen::Index n)
+  {
+    char          magic[Vespa_serializable_lu::MagicSize];
+    std::uint64_t header = 0, fileKey = 0;
+    std::int64_t  fileN = 0, nnzL = 0, nnzU = 0, detPermR = 0, detPermC = 0;
+    if (!is.read(magic, sizeof(magic)) ||
+      !std::equal(magic, magic + sizeof(magic), Vespa_serializable_lu::Magic()) ||
+      !Vespa_serializable_lu::ReadValue(is, header) || header != Vespa_serializable_lu::Header() ||
+      !Vespa_serializable_lu::ReadValue(is, fileKey) || fileKey != key ||
+      !Vespa_serializable_lu::ReadValue(is, fileN) || fileN != n ||
+      !Vespa_serializable_lu::ReadValue(is, nnzL) || !Vespa_serializable_lu::ReadValue(is, nnzU) ||
+      !Vespa_serializable_lu::ReadValue(is, detPermR) ||
+      !Vespa_serializable_lu::ReadValue(is, detPermC))
+    {
+      return false;
+    }
+
+    // the factors of a n x n matrix hold at most n * n values
+    const std::int64_t maxSize = static_cast<std::int64_t>(n) * n + n + 1;
+    auto&              glu     = this->m_glu;
+    IndexVector        permR, permC;
+    if (!Vespa_serializable_lu::ReadVector(is, permR, n) ||
+      !Vespa_serializable_lu::ReadVector(is, permC, n) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.xsup, n + 1) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.supno, n + 1) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.xlsub, n + 1) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.lsub, maxSize) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.xlusup, n + 1) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.lusup, maxSize) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.xusub, n + 1) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.usub, maxSize) ||
+      !Vespa_serializable_lu::ReadVector(is, glu.ucol, maxSize) ||
+      glu.lsub.size() != glu.xlsub(n) || glu.lusup.size() != glu.xlusup(n) ||
+      glu.usub.size() != glu.xusub(n) || glu.ucol.size() != glu.xusub(n) || nnzL < 0 ||
+      nnzU < 0 || std::abs(detPermR) != 1 || std::abs(detPermC) != 1 ||
+      !Vespa_serializable_lu::IsPermutation(permR, n) ||
+      !Vespa_serializable_lu::IsPermutation(permC, n) || !this->HasValidFactors(n))
+    {
+      this->m_factorizationIsOk = false;
+      return false;
+    }
+
+    // same state as at the end of factorize()
+    this->m_perm_r.indices() = permR;
+    this->m_perm_c.indices() = permC;
+    this->m_nnzL             = nnzL;
+    this->m_nnzU             = nnzU;
+    this->m_detPermR         = detPermR;
+    this->m_detPermC         = detPermC;
+    glu.n                    = n;
+    this->m_mat.resize(n, n);
+    this->m_Lstore.setInfos(
+      n, n, glu.lusup, glu.xlusup, glu.lsub, glu.xlsub, glu.supno, glu.xsup);
+    new (&this->m_Ustore) Eigen::MappedSparseMatrix<Scalar, Eigen::ColMajor, StorageIndex>(
+      n, n, nnzU, glu.xusub.data(), glu.usub.data(), glu.ucol.data());
+    this->m_info              = Eigen::Success;
+    this->m_analysisIsOk      = true;
+    this->m_factorizationIsOk = true;
+    this->m_isInitialized     = true;
+    return true;
+  }
+
+private:
+  // Whether the indices are a permutation of [0, n)
+  static bool IsPermutation(const IndexVector& indices, Eigen::Index n)
+  {
+    std::vector<bool> seen(n, false);
+    for (Eigen::Index i = 0; i < n; i++)
+    {
+      if (indices(i) < 0 || indices(i) >= n || seen[indices(i)])
+      {
+        return false;
+      }
+      seen[indices(i)] = true;
+    }
+    return true;
+  }
+
+  // Whether the pointers start at 0, never decrease up to the last one, which
+  // is the end of the indexed values
+  static bool IsMonotone(const IndexVector& pointers, Eigen::Index last, Eigen::Index end)
+  {
+    for (Eigen::Index i = 0; i < last; i++)
+    {
+      if (pointers(i) > pointers(i + 1))
+      {
+        return false;
+      }
+    }
+    return pointers(0) == 0 && pointers(last) == end;
+  }
+
+  // Whether the supernodes and column pointers read from a file only index
+  // inside the factors, as the solve trusts them
+  bool HasValidFactors(Eigen::Index n) const
+  {
+    const auto&        glu    = this->m_glu;
+    const Eigen::Index nsuper = glu.supno(n);
+    if (nsuper < 0 || nsuper >= n || !Vespa_serializable_lu::IsMonotone(glu.xsup, nsuper + 1, n) ||
+      !Vespa_serializable_lu::IsMonotone(glu.xlsub, n, glu.lsub.size()) ||
+      !Vespa_serializable_lu::IsMonotone(glu.xlusup, n, glu.lusup.size()) ||
+      !Vespa_serializable_lu::IsMonotone(glu.xusub, n, glu.usub.size()))
+    {
+      return false;
+    }
+
+    // the values of a supernode are its columns, as high as its row indices
+    for (Eigen::Index k = 0; k <= nsuper; k++)
+    {
+      const Eigen::Index fsupc = glu.xsup(k);
+      const Eigen::Index nsupc = glu.xsup(k + 1) - fsupc;
+      if (nsupc < 1)
+      {
+        return false;
+      }
+      const Eigen::Index nsupr = glu.xlsub(fsupc + 1) - glu.xlsub(fsupc);
+      if (nsupr < nsupc || glu.xlusup(fsupc) + nsupr * nsupc > glu.lusup.size())
+      {
+        return false;
+      }
+      for (Eigen::Index j = fsupc; j < fsupc + nsupc; j++)
+      {
+        if (glu.supno(j) != k || glu.xlusup(j) + nsupr > glu.lusup.size())
+        {
+          return false;
+        }
+      }
+    }
+
+    // row indices
+    const auto inRange = [n](StorageIndex i) { return i >= 0 && i < n; };
+    return std::all_of(glu.lsub.data(), glu.lsub.data() + glu.lsub.size(), inRange) &&
+      std::all_of(glu.usub.data(), glu.usub.data() + glu.usub.size(), inRange);
+  }
+
+  static const char* Magic() { return "VESPALU"; }
+  static constexpr std::size_t MagicSize = 8;
+
+  // format version, Eigen version and type sizes
+  static std::uint64_t Header()
+  {
+    const std::uint64_t format = 1;
+    const std::uint64_t eigen =
+      EIGEN_WORLD_VERSION * 10000 + EIGEN_MAJOR_VERSION * 100 + EIGEN_MINOR_VERSION;
+    return (format << 48) | (eigen << 16) | (sizeof(StorageIndex) << 8) | sizeof(Scalar);
+  }
+
+  template <class T>
+  static void WriteValue(std::ostream& os, const T& value)
+  {
+    os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  template <class T>
+  static bool ReadValue(std::istream& is, T& value)
+  {
+    return static_cast<bool>(is.read(reinterpret_cast<char*>(&value), sizeof(T)));
+  }
+
+  template <class Vector>
+  static void WriteVector(std::ostream& os, const Vector& vector, Eigen::Index size)
+  {
+    Vespa_serializable_lu::WriteValue(os, static_cast<std::int64_t>(size));
+    os.write(reinterpret_cast<const char*>(vector.data()),
+      size * sizeof(typename Vector::Scalar));
+  }
+
+  template <class Vector>
+  static bool ReadVector(std::istream& is, Vector& vector, std::int64_t maxSize)
+  {
+    std::int64_t size = -1;
+    if (!Vespa_serializable_lu::ReadValue(is, size) || size < 0 || size > maxSize)
+    {
+      return false;
+    }
+    vector.resize(size);
+    return static_cast<bool>(is.read(
+      reinterpret_cast<char*>(vector.data()), size * sizeof(typename Vector::Scalar)));
+  }
+};
+
+//------------------------------------------------------------------------------
+// Factorized systems shared in memory by the solvers of the same system
+struct Vespa_factorizations
+{
+  std::mutex                                                                 Mutex;
+  std::unordered_map<std::uint64_t, std::shared_ptr<Vespa_serializable_lu>> Solvers;
+};
+
+//------------------------------------------------------------------------------
+// Direct solver looking up its factorization in memory or in a cache directory
+// before factorizing, and storing it afterwards. The factorizations are keyed by
+// a hash of the system, so they are shared by all the meshes, ROIs and filters
+// producing the same system. The stores are given by the Scope alive in the
+// calling thread, as CGAL default constructs the solvers it owns. Without
+// Scope, this is the SparseLU direct solver.
+class Vespa_cached_direct_solver
+{
+public:
+  using NT     = double;
+  using Matrix = CGAL::Eigen_sparse_matrix<double>;
+  using Vector = CGAL::Eigen_vector<double>;
+
+  // Stores of the solvers factorizing in this thread during its lifetime, and
+  // number of systems they factorized
+  struct Scope
+  {
+    explicit Scope(const std::string& directory, Vespa_factorizations* memory = nullptr)
+      : Directory(directory)
+      , Memory(memory)
+      , Previous(Scope::Current())
+    {
+      Scope::Current() = this;
+    }
+    ~Scope() { Scope::Current() = this->Previous; }
+    Scope(const Scope&) = delete;
+    void operator=(const Scope&) = delete;
+
+    static Scope*& Current()
+    {
+      static thread_local Scope* current = nullptr;
+      return current;
+    }
+
+    std::string           Directory;
+    Vespa_factorizations* Memory;
+    Scope*                Previous;
+    bool                  Shared         = false;
+    bool                  Loaded         = false;
+    bool                  Saved          = false;
+    unsigned int          Factorizations = 0;
+  };
+
+  bool factor(const Matrix& A, NT& D)
+  {
+    D                              = 1;
+    const Vespa_sparse_matrix& mat = A.eigen_object();
+    Scope*                     scope = Scope::Current();
+
+    // a shared factorization is never modified
+    this->Solver = std::make_shared<Vespa_serializable_lu>();
+    if (!scope || (scope->Directory.empty() && !scope->Memory))
+    {
+      if (scope)
+      {
+        scope->Factorizations++;
+      }
+      this->Solver->compute(mat);
+      return this->Solver->info() == Eigen::Success;
+    }
+
+    const std::uint64_t key = Vespa_cached_direct_solver::Hash(mat);
+    if (scope->Memory)
+    {
+      std::lock_guard<std::mutex> lock(scope->Memory->Mutex);
+      auto                        it = scope->Memory->Solvers.find(key);
+      if (it != scope->Memory->Solvers.end() && it->second->cols() == mat.cols())
+      {
+        this->Solver  = it->second;
+        scope->Shared = true;
+        return true;
+      }
+    }
+
+    if (!this->Load(scope, key, mat))
+    {
+      scope->Factorizations++;
+      this->Solver->compute(mat);
+      if (this->Solver->info() != Eigen::Success)
+      {
+        return false;
+      }
+      this->Save(scope, key);
+    }
+
+    if (scope->Memory)
+    {
+      std::lock_guard<std::mutex> lock(scope->Memory->Mutex);
+      scope->Memory->Solvers.emplace(key, this->Solver);
+    }
+    return true;
+  }
+
+  bool linear_solver(const Vector& B, Vector& X)
+  {
+    X = this->Solver->solve(B);
+    return this->Solver->info() == Eigen::Success;
+  }
+
+  bool linear_solver(const Matrix& A, const Vector& B, Vector& X, NT& D)
+  {
+    return this->factor(A, D) && this->linear_solver(B, X);
+  }
+
+private:
+  static std::string Path(Scope* scope, std::uint64_t key)
+  {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.vlu", static_cast<unsigned long long>(key));
+    return scope->Directory + name;
+  }
+
+  bool Load(Scope* scope, std::uint64_t key, const Vespa_sparse_matrix& mat)
+  {
+    if (scope->Directory.empty())
+    {
+      return false;
+    }
+    std::ifstream is(Vespa_cached_direct_solver::Path(scope, key), std::ios::binary);
+    scope->Loaded = is && this->Solver->Read(is, key, mat.cols());
+    return scope->Loaded;
+  }
+
+  void Save(Scope* scope, std::uint64_t key)
+  {
+    if (scope->Directory.empty())
+    {
+      return;
+    }
+
+    // write aside then rename, so that readers never see a partial file
+    const std::string path    = Vespa_cached_direct_solver::Path(scope, key);
+    const std::string tmpPath = path + ".tmp";
+    std::ofstream     os(tmpPath, std::ios::binary | std::ios::trunc);
+    bool              written = os && this->Solver->Write(os, key);
+    os.close();
+    written = written && !os.fail() && std::rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!written)
+    {
+      std::remove(tmpPath.c_str());
+    }
+    scope->Saved = written;
+  }
+
+  // structure and values of the matrix
+  static std::uint64_t Hash(const Vespa_sparse_matrix& mat)
+  {
+    std::uint64_t h   = 0;
+    const auto    mix = [&h](std::uint64_t value) {
+      // splitmix64 finalizer of the running hash
+      std::uint64_t x = h ^ (value + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+      x               = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      x               = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+      h               = x ^ (x >> 31);
+    };
+    mix(static_cast<std::uint64_t>(mat.rows()));
+    for (Eigen::Index col = 0; col < mat.outerSize(); ++col)
+    {
+      mix(static_cast<std::uint64_t>(col));
+      for (Vespa_sparse_matrix::InnerIterator it(mat, col); it; ++it)
+      {
+        std::uint64_t bits;
+        const double  value = it.value();
+        std::memcpy(&bits, &value, sizeof(bits));
+        mix(static_cast<std::uint64_t>(it.index()));
+        mix(bits);
+      }
+    }
+    return h;
+  }
+
+  // shared as in CGAL::Eigen_solver_traits, the factors point into the solver
+  std::shared_ptr<Vespa_serializable_lu> Solver = std::make_shared<Vespa_serializable_lu>();
+};
+
+//------------------------------------------------------------------------------
+// Solver of another backend, counting its factorizations in the Scope alive in
+// the calling thread
+template <class Solver>
+class Vespa_counted_solver : public Solver
+{
+public:
+  bool factor(const typename Solver::Matrix& A, typename Solver::NT& D)
+  {
+    if (Vespa_cached_direct_solver::Scope* scope = Vespa_cached_direct_solver::Scope::Current())
+    {
+      scope->Factorizations++;
+    }
+    return Solver::factor(A, D);
+  }
+};
+
+//------------------------------------------------------------------------------
+// Call functor with a default constructed solver of the backend of self.
+// Backends that were not built fall back on the direct solver.
+template <class Functor>
+void vtkCGALWithSolver(vtkCGALPolyDataAlgorithm* self, Functor&& functor)
+{
+  switch (self->GetSolverBackend())
+  {
+    case vtkCGALPolyDataAlgorithm::PARALLEL_DIRECT_SOLVER:
+#ifdef VESPA_USE_PARDISO
+      functor(Vespa_parallel_direct_solver());
+#else
+      vtkWarningWithObjectMacro(
+        self, "The parallel direct solver is not available, using the direct solver.");
+      functor(Vespa_direct_solver());
+#endif
+      break;
+    case vtkCGALPolyDataAlgorithm::ITERATIVE_SOLVER:
+      functor(Vespa_iterative_solver());
+      break;
+    default:
+      functor(Vespa_direct_solver());
+      break;
+  }
+}
+
+#endif
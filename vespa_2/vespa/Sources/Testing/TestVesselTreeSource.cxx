@@ -0,0 +1,56 @@
+#include <iostream>
+
+#include <vtkAbstractArray.h>
+#include <vtkFeatureEdges.h>
+#include <vtkNew.h>
+#include <vtkPolyData.h>
+#include <vtkSelection.h>
+#include <vtkSelectionNode.h>
+
+#include "vtkCGALVesselTreeSource.h"
+
+int TestVesselTreeSource(int, char*[])
+{
+  // Generate a tree with 3 levels of bifurcations
+
+  vtkNew<vtkCGALVesselTreeSource> tree;
+  tree->SetBifurcationDepth(3);
+  tree->SetResolution(3);
+  tree->Update();
+
+  vtkPolyData* surface = tree->GetOutput();
+  if (surface->GetNumberOfPolys() == 0)
+  {
+    std::cerr << "Empty vessel tree" << std::endl;
+    return 1;
+  }
+
+  // The surface must be closed and manifold
+
+  vtkNew<vtkFeatureEdges> edges;
+  edges->SetInputData(surface);
+  edges->BoundaryEdgesOn();
+  edges->NonManifoldEdgesOn();
+  edges->FeatureEdgesOff();
+  edges->ManifoldEdgesOff();
+  edges->Update();
+  if (edges->GetOutput()->GetNumberOfCells() != 0)
+  {
+    std::cerr << "The vessel tree is not watertight: " << edges->GetOutput()->GetNumberOfCells()
+              << " boundary or non-manifold edges" << std::endl;
+    return 1;
+  }
+
+  // The ROI contains the control points
+
+  vtkIdType nbRoi = tree->GetROIOutput()->GetNode(0)->GetSelectionList()->GetNumberOfTuples();
+  vtkIdType nbControl = tree->GetControlPointsOutput()->GetNumberOfPoints();
+  if (nbControl == 0 || nbRoi < nbControl || nbRoi >= surface->GetNumberOfPoints())
+  {
+    std::cerr << "Unexpected ROI (" << nbRoi << " points) or control points (" << nbControl
+              << " points)" << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,9 @@
+# Global import
+import vespa
+import vtkmodules.vtkCommonCore
+
+# Specific import
+from vespa import vtkCGALSources
+
+vt = vtkCGALSources.vtkCGALVesselTreeSource()
+help(vt)
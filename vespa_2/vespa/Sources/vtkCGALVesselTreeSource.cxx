@@ -0,0 +1,410 @@
+#include "vtkCGALVesselTreeSource.h"
+
+// VTK related includes
+#include "vtkCellArray.h"
+#include "vtkFloatArray.h"
+#include "vtkFlyingEdges3D.h"
+#include "vtkIdTypeArray.h"
+#include "vtkImageData.h"
+#include "vtkInformation.h"
+#include "vtkInformationVector.h"
+#include "vtkIntArray.h"
+#include "vtkMath.h"
+#include "vtkMinimalStandardRandomSequence.h"
+#include "vtkNew.h"
+#include "vtkObjectFactory.h"
+#include "vtkPointData.h"
+#include "vtkPoints.h"
+#include "vtkPolyData.h"
+#include "vtkSMPTools.h"
+#include "vtkSelection.h"
+#include "vtkSelectionNode.h"
+
+// STL related includes
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+vtkStandardNewMacro(vtkCGALVesselTreeSource);
+
+namespace
+{
+// A branch of the tree: a capsule between a and b
+struct Segment
+{
+  double a[3];
+  double b[3];
+  double radius;
+  double axis[3]; // rotation axis of the children, orthogonal to b - a
+  int    parent;
+  int    depth;
+};
+
+//------------------------------------------------------------------------------
+// Rotate v around the unit vector k by theta radians (Rodrigues)
+void rotate(const double v[3], const double k[3], double theta, double out[3])
+{
+  double kxv[3];
+  vtkMath::Cross(k, v, kxv);
+  const double c   = std::cos(theta);
+  const double s   = std::sin(theta);
+  const double kdv = vtkMath::Dot(k, v) * (1. - c);
+  for (int i = 0; i < 3; i++)
+  {
+    out[i] = v[i] * c + kxv[i] * s + k[i] * kdv;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Signed distance from p to the capsule of a segment
+double capsuleDistance(const Segment& seg, const double p[3])
+{
+  double ab[3], ap[3];
+  vtkMath::Subtract(seg.b, seg.a, ab);
+  vtkMath::Subtract(p, seg.a, ap);
+  const double t = vtkMath::ClampValue(vtkMath::Dot(ap, ab) / vtkMath::Dot(ab, ab), 0., 1.);
+  double       closest[3];
+  for (int i = 0; i < 3; i++)
+  {
+    closest[i] = seg.a[i] + t * ab[i];
+  }
+  return std::sqrt(vtkMath::Distance2BetweenPoints(p, closest)) - seg.radius;
+}
+}
+
+//------------------------------------------------------------------------------
+vtkCGALVesselTreeSource::vtkCGALVesselTreeSource()
+{
+  this->SetNumberOfInputPorts(0);
+  this->SetNumberOfOutputPorts(3);
+}
+
+//------------------------------------------------------------------------------
+void vtkCGALVesselTreeSource::PrintSelf(ostream& os, vtkIndent indent)
+{
+  this->Superclass::PrintSelf(os, indent);
+  os << indent << "BifurcationDepth: " << this->BifurcationDepth << std::endl;
+  os << indent << "NumberOfBranches: " << this->NumberOfBranches << std::endl;
+  os << indent << "RootRadius: " << this->RootRadius << std::endl;
+  os << indent << "RootLength: " << this->RootLength << std::endl;
+  os << indent << "RadiusRatio: " << this->RadiusRatio << std::endl;
+  os << indent << "LengthRatio: " << this->LengthRatio << std::endl;
+  os << indent << "BranchAngle: " << this->BranchAngle << std::endl;
+  os << indent << "Resolution: " << this->Resolution << std::endl;
+  os << indent << "Seed: " << this->Seed << std::endl;
+  os << indent << "ControlBranch: " << this->ControlBranch << std::endl;
+  os << indent << "Displacement: " << this->Displacement[0] << ", " << this->Displacement[1]
+     << ", " << this->Displacement[2] << std::endl;
+  os << indent << "GlobalIdArray: " << this->GlobalIdArray << std::endl;
+}
+
+//------------------------------------------------------------------------------
+int vtkCGALVesselTreeSource::FillOutputPortInformation(int port, vtkInformation* info)
+{
+  if (port == 1)
+  {
+    info->Set(vtkDataObject::DATA_TYPE_NAME(), "vtkSelection");
+    return 1;
+  }
+  return this->Superclass::FillOutputPortInformation(port, info);
+}
+
+//------------------------------------------------------------------------------
+vtkSelection* vtkCGALVesselTreeSource::GetROIOutput()
+{
+  return vtkSelection::SafeDownCast(this->GetOutputDataObject(1));
+}
+
+//------------------------------------------------------------------------------
+vtkPolyData* vtkCGALVesselTreeSource::GetControlPointsOutput()
+{
+  return vtkPolyData::SafeDownCast(this->GetOutputDataObject(2));
+}
+
+//------------------------------------------------------------------------------
+int vtkCGALVesselTreeSource::RequestData(
+  vtkInformation*, vtkInformationVector**, vtkInformationVector* outputVector)
+{
+  vtkPolyData*  output        = vtkPolyData::GetData(outputVector, 0);
+  vtkSelection* roiOutput     = vtkSelection::GetData(outputVector, 1);
+  vtkPolyData*  controlOutput = vtkPolyData::GetData(outputVector, 2);
+
+  // Branches, level by level
+  // ------------------------
+
+  std::vector<::Segment> segments;
+  segments.push_back({ { 0., 0., 0. }, { 0., 0., this->RootLength }, this->RootRadius,
+    { 1., 0., 0. }, -1, 0 });
+
+  vtkNew<vtkMinimalStandardRandomSequence> random;
+  random->SetSeed(this->Seed);
+
+  const double angle = vtkMath::RadiansFromDegrees(this->BranchAngle);
+  const auto   full  = [&]() {
+    return this->NumberOfBranches > 0 &&
+      segments.size() >= static_cast<std::size_t>(this->NumberOfBranches);
+  };
+  for (std::size_t s = 0; s < segments.size() && !full(); s++)
+  {
+    if (segments[s].depth >= this->BifurcationDepth)
+    {
+      continue;
+    }
+    const ::Segment parent = segments[s];
+
+    double dir[3];
+    vtkMath::Subtract(parent.b, parent.a, dir);
+    const double length = vtkMath::Normalize(dir);
+
+    // successive bifurcation planes are roughly orthogonal
+    double       axis[3];
+    const double twist = vtkMath::RadiansFromDegrees(90. + random->GetNextRangeValue(-30., 30.));
+    ::rotate(parent.axis, dir, twist, axis);
+
+    for (double side : { -1., 1. })
+    {
+      if (full())
+      {
+        break;
+      }
+      ::Segment child;
+      double    childDir[3];
+      ::rotate(dir, axis, side * angle, childDir);
+      std::copy(parent.b, parent.b + 3, child.a);
+      for (int i = 0; i < 3; i++)
+      {
+        child.b[i]    = parent.b[i] + childDir[i] * length * this->LengthRatio;
+        child.axis[i] = axis[i];
+      }
+      child.radius = parent.radius * this->RadiusRatio;
+      child.parent = static_cast<int>(s);
+      child.depth  = parent.depth + 1;
+      segments.push_back(child);
+    }
+  }
+
+  // Distance field on a regular grid
+  // --------------------------------
+
+  double minRadius = VTK_DOUBLE_MAX;
+  double bounds[6] = { VTK_DOUBLE_MAX, VTK_DOUBLE_MIN, VTK_DOUBLE_MAX, VTK_DOUBLE_MIN,
+    VTK_DOUBLE_MAX, VTK_DOUBLE_MIN };
+  for (const ::Segment& seg : segments)
+  {
+    minRadius = std::min(minRadius, seg.radius);
+    for (int i = 0; i < 3; i++)
+    {
+      const double lo   = std::min(seg.a[i], seg.b[i]) - seg.radius;
+      const double hi   = std::max(seg.a[i], seg.b[i]) + seg.radius;
+      bounds[2 * i]     = std::min(bounds[2 * i], lo);
+      bounds[2 * i + 1] = std::max(bounds[2 * i + 1], hi);
+    }
+  }
+
+  // keep a margin of a few cells so that the surface is closed
+  const double spacing = minRadius / this->Resolution;
+  const double margin  = 2. * spacing;
+  double       origin[3];
+  int          dims[3];
+  for (int i = 0; i < 3; i++)
+  {
+    origin[i] = bounds[2 * i] - margin;
+    dims[i] =
+      static_cast<int>(std::ceil((bounds[2 * i + 1] - bounds[2 * i] + 2. * margin) / spacing)) + 1;
+  }
+  const vtkIdType sliceSize = static_cast<vtkIdType>(dims[0]) * dims[1];
+  const vtkIdType nbNodes   = sliceSize * dims[2];
+
+  vtkNew<vtkFloatArray> field;
+  field->SetName("Distance");
+  field->SetNumberOfValues(nbNodes);
+  field->FillValue(VTK_FLOAT_MAX);
+  float* dist = field->GetPointer(0);
+
+  // closest branch of each node
+  std::vector<int> owner(nbNodes, 0);
+
+  for (std::size_t s = 0; s < segments.size(); s++)
+  {
+    const ::Segment& seg = segments[s];
+
+    // only visit the nodes around the capsule
+    int range[6];
+    for (int i = 0; i < 3; i++)
+    {
+      const double lo  = std::min(seg.a[i], seg.b[i]) - seg.radius - margin;
+      const double hi  = std::max(seg.a[i], seg.b[i]) + seg.radius + margin;
+      const int    iLo = static_cast<int>(std::floor((lo - origin[i]) / spacing));
+      const int    iHi = static_cast<int>(std::ceil((hi - origin[i]) / spacing));
+      range[2 * i]     = std::max(0, iLo);
+      range[2 * i + 1] = std::min(dims[i] - 1, iHi);
+    }
+
+    vtkSMPTools::For(range[4], range[5] + 1, [&](vtkIdType kBegin, vtkIdType kEnd) {
+      double p[3];
+      for (vtkIdType k = kBegin; k < kEnd; k++)
+      {
+        p[2] = origin[2] + k * spacing;
+        for (int j = range[2]; j <= range[3]; j++)
+        {
+          p[1] = origin[1] + j * spacing;
+          for (int i = range[0]; i <= range[1]; i++)
+          {
+            p[0]                = origin[0] + i * spacing;
+            const vtkIdType id  = k * sliceSize + j * dims[0] + i;
+            const float     val = static_cast<float>(::capsuleDistance(seg, p));
+            if (val < dist[id])
+            {
+              dist[id]  = val;
+              owner[id] = static_cast<int>(s);
+            }
+          }
+        }
+      }
+    });
+  }
+  this->UpdateProgress(0.5);
+
+  // Surface
+  // -------
+
+  vtkNew<vtkImageData> grid;
+  grid->SetDimensions(dims);
+  grid->SetOrigin(origin);
+  grid->SetSpacing(spacing, spacing, spacing);
+  grid->GetPointData()->SetScalars(field);
+
+  vtkNew<vtkFlyingEdges3D> contour;
+  contour->SetInputData(grid);
+  contour->SetValue(0, 0.);
+  contour->ComputeNormalsOff();
+  contour->ComputeGradientsOff();
+  contour->ComputeScalarsOff();
+  contour->Update();
+
+  output->ShallowCopy(contour->GetOutput());
+  output->GetPointData()->Initialize();
+  output->GetCellData()->Initialize();
+
+  const vtkIdType nbPoints = output->GetNumberOfPoints();
+  vtkPoints*      points   = output->GetPoints();
+  vtkCellArray*   polys    = output->GetPolys();
+  if (nbPoints == 0 || !polys)
+  {
+    vtkErrorMacro("The vessel tree surface is empty.");
+    return 0;
+  }
+
+  // orient the triangles outward
+  double volume = 0.;
+  {
+    vtkIdType        npts;
+    const vtkIdType* pts;
+    double           p0[3], p1[3], p2[3], cross[3];
+    for (polys->InitTraversal(); polys->GetNextCell(npts, pts);)
+    {
+      points->GetPoint(pts[0], p0);
+      points->GetPoint(pts[1], p1);
+      points->GetPoint(pts[2], p2);
+      vtkMath::Cross(p1, p2, cross);
+      volume += vtkMath::Dot(p0, cross);
+    }
+  }
+  if (volume < 0.)
+  {
+    for (vtkIdType c = 0; c < polys->GetNumberOfCells(); c++)
+    {
+      polys->ReverseCellAtId(c);
+    }
+  }
+
+  // Point IDs and branches
+  // ----------------------
+
+  vtkNew<vtkIdTypeArray> globalIds;
+  globalIds->SetName(this->GlobalIdArray.c_str());
+  globalIds->SetNumberOfValues(nbPoints);
+
+  vtkNew<vtkIntArray> branchIds;
+  branchIds->SetName("BranchId");
+  branchIds->SetNumberOfValues(nbPoints);
+
+  vtkSMPTools::For(0, nbPoints, [&](vtkIdType begin, vtkIdType end) {
+    double p[3];
+    int    node[3];
+    for (vtkIdType pid = begin; pid < end; pid++)
+    {
+      points->GetPoint(pid, p);
+      for (int i = 0; i < 3; i++)
+      {
+        node[i] = vtkMath::ClampValue(
+          static_cast<int>(std::lround((p[i] - origin[i]) / spacing)), 0, dims[i] - 1);
+      }
+      globalIds->SetValue(pid, pid);
+      branchIds->SetValue(pid, owner[node[2] * sliceSize + node[1] * dims[0] + node[0]]);
+    }
+  });
+
+  output->GetPointData()->SetGlobalIds(globalIds);
+  output->GetPointData()->AddArray(branchIds);
+
+  // ROI and control points
+  // ----------------------
+
+  int control = this->ControlBranch;
+  if (control < 0 || control >= static_cast<int>(segments.size()))
+  {
+    if (control >= 0)
+    {
+      vtkWarningMacro("ControlBranch " << control << " does not exist, using the last branch.");
+    }
+    control = static_cast<int>(segments.size()) - 1;
+  }
+
+  // parents are created before their children
+  std::vector<bool> inRoi(segments.size(), false);
+  for (std::size_t s = 0; s < segments.size(); s++)
+  {
+    inRoi[s] = static_cast<int>(s) == control ||
+      (segments[s].parent >= 0 && inRoi[segments[s].parent]);
+  }
+
+  vtkNew<vtkIdTypeArray> roiIds;
+  vtkNew<vtkPoints>      controlPoints;
+  controlPoints->SetDataTypeToDouble();
+  vtkNew<vtkIdTypeArray> controlIds;
+  controlIds->SetName(this->GlobalIdArray.c_str());
+
+  const ::Segment& controlSeg = segments[control];
+  const double     tipRadius2 = 2.25 * controlSeg.radius * controlSeg.radius;
+  for (vtkIdType pid = 0; pid < nbPoints; pid++)
+  {
+    if (!inRoi[branchIds->GetValue(pid)])
+    {
+      continue;
+    }
+    roiIds->InsertNextValue(pid);
+
+    double p[3];
+    points->GetPoint(pid, p);
+    if (vtkMath::Distance2BetweenPoints(p, controlSeg.b) <= tipRadius2)
+    {
+      vtkMath::Add(p, this->Displacement, p);
+      controlPoints->InsertNextPoint(p);
+      controlIds->InsertNextValue(pid);
+    }
+  }
+
+  vtkNew<vtkSelectionNode> node;
+  node->SetContentType(vtkSelectionNode::INDICES);
+  node->SetFieldType(vtkSelectionNode::POINT);
+  node->SetSelectionList(roiIds);
+  roiOutput->Initialize();
+  roiOutput->AddNode(node);
+
+  controlOutput->Initialize();
+  controlOutput->SetPoints(controlPoints);
+  controlOutput->GetPointData()->AddArray(controlIds);
+
+  return 1;
+}
@@ -0,0 +1,175 @@
+/**
+ * @class   vtkCGALVesselTreeSource
+ * @brief   generates a synthetic vascular tree
+ *
+ * vtkCGALVesselTreeSource creates a watertight, 2-manifold triangulated surface
+ * of a branching tubular network. Starting from a root segment along the Z axis,
+ * each segment splits into two thinner and shorter children, until the
+ * bifurcation depth or the number of branches is reached.
+ * The surface is the zero level set of the distance to the union of the
+ * segments, contoured on a regular grid whose spacing is driven by the
+ * Resolution (number of grid cells per radius of the thinnest branch): the
+ * number of triangles grows with the square of the Resolution.
+ *
+ * The source has three outputs, ready to be used by vtkCGALMeshDeformation:
+ *   - port 0: the vtkPolyData surface, with point global IDs and the
+ *     "BranchId" of each point,
+ *   - port 1: a vtkSelection of point indices for the ROI, i.e. the points of
+ *     the ControlBranch and of its descendants,
+ *   - port 2: a vtkPolyData with the control points, i.e. the points of the ROI
+ *     near the end of the ControlBranch, moved by the Displacement and
+ *     identified by their global IDs.
+ *
+ * The generation is deterministic for a given Seed.
+ */
+
+#ifndef vtkCGALVesselTreeSource_h
+#define vtkCGALVesselTreeSource_h
+
+#include "vtkPolyDataAlgorithm.h"
+
+#include "vtkCGALSourcesModule.h" // For export macro
+
+#include <string> // For GlobalIdArray
+
+class vtkSelection;
+
+class VTKCGALSOURCES_EXPORT vtkCGALVesselTreeSource : public vtkPolyDataAlgorithm
+{
+public:
+  static vtkCGALVesselTreeSource* New();
+  vtkTypeMacro(vtkCGALVesselTreeSource, vtkPolyDataAlgorithm);
+  void PrintSelf(ostream& os, vtkIndent indent) override;
+
+  ///@{
+  /**
+   * Get/set the number of successive bifurcations from the root.
+   * Default is 3.
+   **/
+  vtkGetMacro(BifurcationDepth, int);
+  vtkSetClampMacro(BifurcationDepth, int, 0, 20);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the maximal number of branches (segments) of the tree.
+   * Branches are created level by level, so a partial last level is kept
+   * when this number is reached. 0 means no limit other than the depth.
+   * Default is 0.
+   **/
+  vtkGetMacro(NumberOfBranches, int);
+  vtkSetClampMacro(NumberOfBranches, int, 0, VTK_INT_MAX);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the radius and length of the root segment.
+   * Default are 1 and 10.
+   **/
+  vtkGetMacro(RootRadius, double);
+  vtkSetClampMacro(RootRadius, double, 1e-6, VTK_DOUBLE_MAX);
+  vtkGetMacro(RootLength, double);
+  vtkSetClampMacro(RootLength, double, 1e-6, VTK_DOUBLE_MAX);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the ratio between the radius (resp. length) of a child branch
+   * and its parent. The default radius ratio, 0.79, follows Murray's law
+   * for symmetric bifurcations. Default length ratio is 0.8.
+   **/
+  vtkGetMacro(RadiusRatio, double);
+  vtkSetClampMacro(RadiusRatio, double, 0.05, 1.);
+  vtkGetMacro(LengthRatio, double);
+  vtkSetClampMacro(LengthRatio, double, 0.05, 1.);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the angle in degrees between a child branch and its parent.
+   * Default is 35.
+   **/
+  vtkGetMacro(BranchAngle, double);
+  vtkSetClampMacro(BranchAngle, double, 0., 90.);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the number of grid cells per radius of the thinnest branch,
+   * which drives the triangle density.
+   * Default is 4.
+   **/
+  vtkGetMacro(Resolution, double);
+  vtkSetClampMacro(Resolution, double, 1., VTK_DOUBLE_MAX);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the seed of the random rotation of the bifurcation planes.
+   * Default is 1.
+   **/
+  vtkGetMacro(Seed, int);
+  vtkSetMacro(Seed, int);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the index of the branch defining the ROI and the control points.
+   * -1 means the last created branch, which is a leaf.
+   * Default is -1.
+   **/
+  vtkGetMacro(ControlBranch, int);
+  vtkSetMacro(ControlBranch, int);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the displacement applied to the control points.
+   * Default is (1, 0, 0).
+   **/
+  vtkGetVector3Macro(Displacement, double);
+  vtkSetVector3Macro(Displacement, double);
+  ///@}
+
+  ///@{
+  /**
+   * Get/set the name of the point global IDs array, shared by the surface and
+   * the control points.
+   * Default is "GlobalIds".
+   **/
+  vtkGetMacro(GlobalIdArray, std::string);
+  vtkSetMacro(GlobalIdArray, std::string);
+  ///@}
+
+  /**
+   * Get the outputs with the ROI selection and the control points.
+   **/
+  vtkSelection* GetROIOutput();
+  vtkPolyData*  GetControlPointsOutput();
+
+protected:
+  vtkCGALVesselTreeSource();
+  ~vtkCGALVesselTreeSource() override = default;
+
+  int RequestData(vtkInformation*, vtkInformationVector**, vtkInformationVector*) override;
+  int FillOutputPortInformation(int port, vtkInformation* info) override;
+
+  int         BifurcationDepth = 3;
+  int         NumberOfBranches = 0;
+  double      RootRadius       = 1.;
+  double      RootLength       = 10.;
+  double      RadiusRatio      = 0.79;
+  double      LengthRatio      = 0.8;
+  double      BranchAngle      = 35.;
+  double      Resolution       = 4.;
+  int         Seed             = 1;
+  int         ControlBranch    = -1;
+  double      Displacement[3]  = { 1., 0., 0. };
+  std::string GlobalIdArray    = "GlobalIds";
+
+private:
+  vtkCGALVesselTreeSource(const vtkCGALVesselTreeSource&) = delete;
+  void operator=(const vtkCGALVesselTreeSource&)          = delete;
+};
+
+#endif